@@ -0,0 +1,93 @@
+// Messages exchanged by a single student safehouse acquisition.
+//
+// Compares the all-to-all Ricart-Agrawala exchange (REQ + ACK to every other student) with the grid quorum
+// protocol used by `Student`. Uncontended acquisition costs REQ + ACK + RELEASE to every other quorum member,
+// less when a RELEASE rides along with the next REQ. Contention adds INQUIRE, RELINQUISH and FAILED and the same
+// member may grant more than once, so neither figure bounds the real cost, which is measured in the
+// discrete-event simulator instead: quorum messages students sent per acquisition, one winemaker per safehouse,
+// everything else (volumes, latency model, seed, selection policy, batching) from the configuration file.
+// Student and safehouse counts grow together, so number of students per safehouse stays fixed. Last line reports
+// the smallest measured student count from which the quorum beats all-to-all, below it the grid costs more.
+//
+// Run with: ./bin/bench_acquisition [config.toml] [simulated seconds]
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../src/config.hpp"
+#include "../src/quorum.hpp"
+#include "../src/runner.hpp"
+
+using namespace nouveaux;
+
+namespace {
+    // Messages of the students' quorum protocol.
+    constexpr Message::Type QUORUM_TYPES[] = {
+        Message::Type::STUDENT_REQUEST,
+        Message::Type::STUDENT_ACKNOWLEDGE,
+        Message::Type::STUDENT_RELEASE,
+        Message::Type::STUDENT_INQUIRE,
+        Message::Type::STUDENT_RELINQUISH,
+        Message::Type::STUDENT_FAILED,
+        Message::Type::STUDENT_RELEASE_REQUEST,
+    };
+}
+
+int main(int argc, char** argv) {
+    const uint64_t students_per_safehouse = 4;
+    const uint64_t max_students = 512;
+
+    auto config = Config::parse(argc > 1 ? argv[1] : "config.toml");
+    config.transport = "simulation";
+    config.exclusion = "permission";
+    config.simulation_duration = argc > 2 ? std::atof(argv[2]) : 0.5;
+    config.event_log = "";
+    config.flight_recorder = 0;
+    config.stock_table = false;
+    if (!validate(config)) {
+        return -1;
+    }
+
+    std::printf("%10s %10s %8s %14s %14s %14s\n", "students", "safehouses", "quorum", "all-to-all", "uncontended", "quorum (sim)");
+    uint64_t crossover = 0;
+    for (uint64_t students = 8; students <= max_students; students *= 2) {
+        const auto safehouses = students / students_per_safehouse;
+
+        // Quorum sizes differ by one at most, take the average one.
+        uint64_t total = 0;
+        for (uint64_t student = 0; student < students; ++student)
+            total += grid_quorum(student, students).size() - 1;
+        const auto peers = static_cast<double>(total) / static_cast<double>(students);
+
+        config.student_count = students;
+        config.safehouse_count = safehouses;
+        config.winemaker_count = safehouses;
+        const auto report = run_simulation(config);
+        uint64_t messages = 0;
+        for (auto type : QUORUM_TYPES)
+            messages += report.students.sent[static_cast<size_t>(type)];
+        const auto acquisitions = report.students.ack_wait.count;
+
+        const auto all_to_all = 2.0 * static_cast<double>(students - 1);
+        const auto measured = acquisitions > 0 ? static_cast<double>(messages) / static_cast<double>(acquisitions) : 0.0;
+        if (crossover == 0 && acquisitions > 0 && measured < all_to_all) {
+            crossover = students;
+        }
+        std::printf("%10lu %10lu %8.1f %14.1f %14.1f %14.1f\n",
+            students,
+            safehouses,
+            peers + 1,
+            all_to_all,
+            3.0 * peers,
+            measured);
+        std::fflush(stdout);
+    }
+
+    if (crossover > 0) {
+        std::printf("quorum beats all-to-all from %lu students on\n", crossover);
+    } else {
+        std::printf("quorum never beats all-to-all up to %lu students\n", max_students);
+    }
+
+    return 0;
+}
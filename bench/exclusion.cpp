@@ -0,0 +1,71 @@
+// Permission based vs token based vs lock manager safehouse exclusion, all run in the discrete-event simulator.
+//
+// Students, safehouses and winemakers grow together (10 students and one winemaker per safehouse),
+// everything else (volumes, latency model, seed, selection policy) comes from the configuration file.
+// Wine produced is the useful work, consumption above it is what students took from stale views
+// of the permission protocol. Messages per acquisition count every delivered message, broadcasts included,
+// lock messages per acquisition only the lock manager's LOCK_REQUEST, LOCK_GRANT and LOCK_RELEASE per lock granted,
+// including locks of safehouses that turned out empty and locks managers grant themselves without any message.
+//
+// Run with: ./bin/bench_exclusion [config.toml] [simulated seconds]
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../src/config.hpp"
+#include "../src/runner.hpp"
+
+using namespace nouveaux;
+
+namespace {
+    // Messages of the lock manager protocol.
+    constexpr Message::Type LOCK_TYPES[] = {
+        Message::Type::LOCK_REQUEST,
+        Message::Type::LOCK_GRANT,
+        Message::Type::LOCK_RELEASE,
+    };
+}
+
+int main(int argc, char** argv) {
+    auto config = Config::parse(argc > 1 ? argv[1] : "config.toml");
+    config.transport = "simulation";
+    config.simulation_duration = argc > 2 ? std::atof(argv[2]) : 1.0;
+    config.event_log = "";
+    config.flight_recorder = 0;
+    config.stock_table = false;
+    if (!validate(config)) {
+        return -1;
+    }
+
+    const auto duration = config.simulation_duration;
+    std::printf("%-10s %8s %10s %12s %12s %10s %10s %10s %12s\n", "exclusion", "students", "safehouses", "produced/s", "consumed/s", "msgs/acq", "lock/acq", "skips", "wait p50 ms");
+    for (uint64_t students = 20; students <= 640; students *= 2) {
+        for (auto exclusion : { "permission", "token", "manager" }) {
+            config.exclusion = exclusion;
+            config.student_count = students;
+            config.safehouse_count = students / 10;
+            config.winemaker_count = students / 10;
+
+            const auto report = run_simulation(config);
+            const auto acquisitions = report.winemakers.ack_wait.count + report.students.ack_wait.count;
+            uint64_t locks = 0;
+            for (auto type : LOCK_TYPES)
+                locks += report.winemakers.sent[static_cast<size_t>(type)] + report.students.sent[static_cast<size_t>(type)];
+            // Managers are winemakers, lock they grant themselves takes no message and counts as reuse.
+            const auto grants = report.winemakers.sent[static_cast<size_t>(Message::Type::LOCK_GRANT)] + report.winemakers.reuses;
+            std::printf("%-10s %8lu %10lu %12.1f %12.1f %10.1f %10.2f %10lu %12.3f\n",
+                exclusion,
+                students,
+                config.safehouse_count,
+                static_cast<double>(report.winemakers.wine_volume) / duration,
+                static_cast<double>(report.students.wine_volume) / duration,
+                acquisitions > 0 ? static_cast<double>(report.delivered) / static_cast<double>(acquisitions) : 0.0,
+                grants > 0 ? static_cast<double>(locks) / static_cast<double>(grants) : 0.0,
+                report.students.skips,
+                static_cast<double>(report.students.ack_wait.percentile(0.5)) / 1e6);
+            std::fflush(stdout);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Ping-pong between two ranks, legacy fixed 64-bit word encoding vs `codec`.
+//
+// For every message type rank 0 sends a message to rank 1 which sends it straight back.
+// Reported latency is half of the round-trip time (encoding and decoding included),
+// bandwidth gain is the ratio of bytes each encoding puts on the wire per message.
+// Messages this small are latency bound, so fewer bytes don't shorten the round trip: on a single node both columns
+// stay around 0.6 us and `codec` is a few hundredths slower for the varint work. The gain is in bytes only.
+//
+// Run with: mpirun -np 2 ./bin/bench_pingpong [iterations]
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mpi.h>
+
+#include "../src/codec.hpp"
+
+using namespace nouveaux;
+
+namespace {
+    constexpr int TAG = 1;
+
+    // Number of 64-bit words each type took before `codec` (timestamp + payload prefix).
+    // Token messages came later, they are counted as timestamp, safehouse and one more word,
+    // piggybacked release as the longest legacy message, termination messages as bare timestamp.
+    constexpr int LEGACY_WORDS[] = { 0, 2, 1, 3, 3, 4, 2, 2, 4, 4, 4, 3, 3, 4, 1, 1, 2, 3, 3, 3 };
+    static_assert(sizeof(LEGACY_WORDS) / sizeof(int) == codec::TYPE_COUNT, "legacy sizes must cover every type");
+
+    // Values typical for a run that has been going for a while.
+    auto sample(Message::Type type) -> Message {
+        return Message {
+            type,
+            1,
+            150000,
+            Message::Payload { 2, 97, 149993, 5, 3, 149990, 0b101 },
+        };
+    }
+
+    auto legacy(int rank, const Message& message, int iterations) -> double {
+        const auto words = LEGACY_WORDS[static_cast<size_t>(message.type)];
+        uint64_t buffer[4];
+        auto start = MPI_Wtime();
+        for (int i = 0; i < iterations; ++i) {
+            if (rank == 0) {
+                uint64_t out[4] = { message.timestamp, message.payload.safehouse_index, message.payload.wine_volume, message.payload.last_timestamp };
+                MPI_Send(out, words, MPI_LONG_LONG, 1, TAG, MPI_COMM_WORLD);
+                MPI_Recv(buffer, 4, MPI_LONG_LONG, 1, TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            } else {
+                MPI_Recv(buffer, 4, MPI_LONG_LONG, 0, TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                MPI_Send(buffer, words, MPI_LONG_LONG, 0, TAG, MPI_COMM_WORLD);
+            }
+        }
+        return MPI_Wtime() - start;
+    }
+
+    auto packed(int rank, const Message& message, int iterations) -> double {
+        uint8_t buffer[codec::MAX_SIZE];
+        MPI_Status status;
+        int size = 0;
+        volatile uint64_t sink = 0;
+        auto start = MPI_Wtime();
+        for (int i = 0; i < iterations; ++i) {
+            if (rank == 0) {
+                size = codec::encode(message, buffer);
+                MPI_Send(buffer, size, MPI_BYTE, 1, TAG, MPI_COMM_WORLD);
+                MPI_Recv(buffer, codec::MAX_SIZE, MPI_BYTE, 1, TAG, MPI_COMM_WORLD, &status);
+            } else {
+                MPI_Recv(buffer, codec::MAX_SIZE, MPI_BYTE, 0, TAG, MPI_COMM_WORLD, &status);
+                MPI_Get_count(&status, MPI_BYTE, &size);
+                auto received = codec::decode(buffer, size, 0);
+                sink = received.timestamp;
+                size = codec::encode(received, buffer);
+                MPI_Send(buffer, size, MPI_BYTE, 0, TAG, MPI_COMM_WORLD);
+            }
+        }
+        (void)sink;
+        return MPI_Wtime() - start;
+    }
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (size != 2) {
+        if (rank == 0)
+            std::fprintf(stderr, "Ping-pong requires exactly 2 processes.\n");
+        MPI_Finalize();
+        return -1;
+    }
+
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+    if (rank == 0)
+        std::printf("%-29s %8s %8s %8s %12s %12s\n", "type", "legacy B", "codec B", "gain", "legacy us", "codec us");
+
+    for (size_t type = 1; type < codec::TYPE_COUNT; ++type) {
+        auto message = sample(static_cast<Message::Type>(type));
+        uint8_t buffer[codec::MAX_SIZE];
+        const auto legacy_bytes = LEGACY_WORDS[type] * sizeof(uint64_t);
+        const auto codec_bytes = codec::encode(message, buffer);
+
+        // Warm up both paths before measuring.
+        legacy(rank, message, iterations / 10);
+        packed(rank, message, iterations / 10);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        auto legacy_time = legacy(rank, message, iterations);
+        MPI_Barrier(MPI_COMM_WORLD);
+        auto codec_time = packed(rank, message, iterations);
+
+        if (rank == 0) {
+            const auto messages = 2.0 * iterations;
+            std::printf("%-29s %8zu %8zu %7.1fx %12.3f %12.3f\n",
+                codec::LAYOUTS[type].name,
+                legacy_bytes,
+                codec_bytes,
+                static_cast<double>(legacy_bytes) / static_cast<double>(codec_bytes),
+                legacy_time / messages * 1e6,
+                codec_time / messages * 1e6);
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}
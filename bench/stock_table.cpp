@@ -0,0 +1,134 @@
+// Safehouse stock kept in messages vs in the RMA `StockTable`.
+//
+// Publication: rank 0 stocks a safehouse and everybody else has to learn about it. Message path sends
+// WINEMAKER_BROADCAST to every other rank (students), which receive it; table path is one
+// accumulate into the window. Time runs until every rank has the news (closing barrier included).
+//
+// Consumption: every rank in turn takes one unit out of a safehouse. Message path is a single
+// uncontended all-to-all REQ/ACK round (what Ricart-Agrawala needs at least, quorums send fewer but
+// also RELEASE), table path is `StockTable::consume` issued by all ranks at once, so it's contended.
+//
+// Run with: mpirun -np <students + 1> ./bin/bench_stock_table [iterations]
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mpi.h>
+
+#include "../src/codec.hpp"
+#include "../src/stock_table.hpp"
+
+using namespace nouveaux;
+
+namespace {
+    constexpr uint64_t SAFEHOUSES = 16;
+
+    auto sample(Message::Type type, uint64_t safehouse) -> Message {
+        return Message { type, 0, 150000, Message::Payload { safehouse, 5, 149993, 0, 0, 0, 0 } };
+    }
+
+    auto broadcast(int rank, int size, int iterations) -> double {
+        uint8_t buffer[codec::MAX_SIZE];
+        const auto start = MPI_Wtime();
+        for (int i = 0; i < iterations; ++i) {
+            if (rank == 0) {
+                const auto length = codec::encode(sample(Message::Type::WINEMAKER_BROADCAST, i % SAFEHOUSES), buffer);
+                for (int peer = 1; peer < size; ++peer) {
+                    MPI_Send(buffer, length, MPI_BYTE, peer, WINEMAKER_BROADCAST, MPI_COMM_WORLD);
+                }
+            } else {
+                MPI_Recv(buffer, codec::MAX_SIZE, MPI_BYTE, 0, WINEMAKER_BROADCAST, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        return MPI_Wtime() - start;
+    }
+
+    auto publish(int rank, StockTable& table, int iterations) -> double {
+        const auto start = MPI_Wtime();
+        for (int i = 0; rank == 0 && i < iterations; ++i) {
+            table.deposit(i % SAFEHOUSES, 5);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        return MPI_Wtime() - start;
+    }
+
+    auto request_rounds(int rank, int size, int iterations) -> double {
+        uint8_t buffer[codec::MAX_SIZE];
+        const auto request_length = codec::encode(sample(Message::Type::STUDENT_REQUEST, 0), buffer);
+        const auto start = MPI_Wtime();
+        for (int i = 0; i < iterations; ++i) {
+            const auto requester = i % size;
+            if (rank == requester) {
+                for (int peer = 0; peer < size; ++peer) {
+                    if (peer != rank)
+                        MPI_Send(buffer, request_length, MPI_BYTE, peer, STUDENT_ACQUIRE_REQ, MPI_COMM_WORLD);
+                }
+                for (int peer = 1; peer < size; ++peer) {
+                    MPI_Recv(buffer, codec::MAX_SIZE, MPI_BYTE, MPI_ANY_SOURCE, STUDENT_ACQUIRE_ACK, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                }
+            } else {
+                MPI_Recv(buffer, codec::MAX_SIZE, MPI_BYTE, requester, STUDENT_ACQUIRE_REQ, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                const auto length = codec::encode(sample(Message::Type::STUDENT_ACKNOWLEDGE, 0), buffer);
+                MPI_Send(buffer, length, MPI_BYTE, requester, STUDENT_ACQUIRE_ACK, MPI_COMM_WORLD);
+            }
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        return MPI_Wtime() - start;
+    }
+
+    auto consume(int rank, int size, StockTable& table, int iterations) -> double {
+        // Enough stock for everyone, so every consumption is a single fetch-and-op.
+        if (rank == 0)
+            table.deposit(0, static_cast<uint64_t>(iterations) * 2);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        const auto start = MPI_Wtime();
+        volatile uint64_t sink = 0;
+        for (int i = rank; i < iterations; i += size) {
+            sink = table.consume(0, 1).volume;
+        }
+        (void)sink;
+        MPI_Barrier(MPI_COMM_WORLD);
+        return MPI_Wtime() - start;
+    }
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (size < 2) {
+        if (rank == 0)
+            std::fprintf(stderr, "Stock table benchmark requires at least 2 processes.\n");
+        MPI_Finalize();
+        return -1;
+    }
+
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 10000;
+
+    {
+        StockTable table(SAFEHOUSES);
+
+        // Warm up both paths before measuring.
+        broadcast(rank, size, iterations / 10);
+        publish(rank, table, iterations / 10);
+
+        const auto broadcast_time = broadcast(rank, size, iterations);
+        const auto publish_time = publish(rank, table, iterations);
+        const auto round_time = request_rounds(rank, size, iterations);
+        const auto consume_time = consume(rank, size, table, iterations);
+
+        if (rank == 0) {
+            std::printf("%d ranks, %d iterations\n", size, iterations);
+            std::printf("%-12s %14s %14s %14s %14s\n", "", "messages", "table", "msgs/op", "speedup");
+            std::printf("%-12s %12.3fus %12.3fus %14d %13.2fx\n", "publication", broadcast_time / iterations * 1e6, publish_time / iterations * 1e6, size - 1, broadcast_time / publish_time);
+            std::printf("%-12s %12.3fus %12.3fus %14d %13.2fx\n", "consumption", round_time / iterations * 1e6, consume_time / iterations * 1e6, 2 * (size - 1), round_time / consume_time);
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}
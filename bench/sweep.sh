@@ -0,0 +1,97 @@
+#!/bin/sh
+# Parameter sweep of bounded runs, every trial appends one row (totals, throughput, latency percentiles and
+# message counts) to the results CSV.
+#
+# Every trial runs in its own directory with `config.toml` made of the base config without the swept
+# parameter and bounds, the swept value, `BOUND`, `results` and `seed = <trial>`, so trials are distinct
+# but repeatable. Processes are `winemaker_count + student_count` except for the `processes` sweep, which
+# spreads the same actors over a varying number of ranks of hybrid transport.
+#
+# Run with: bench/sweep.sh <parameter> "<values>" [trials]
+#   parameter: winemaker_count, student_count, safehouse_count, broadcast_arity, wine_volume_range (values as min:max)
+#   or processes
+#
+# Environment: BIN (winemaker binary), BASE (base config), RESULTS (CSV file), BOUND (bound of single run),
+# MPIRUN (launcher with its options).
+set -e
+
+PARAMETER=$1
+VALUES=$2
+TRIALS=${3:-3}
+BIN=$(realpath "${BIN:-bin/winemaker}")
+BASE=$(realpath "${BASE:-config.toml}")
+RESULTS=$(realpath -m "${RESULTS:-bin/bench.csv}")
+BOUND=${BOUND:-rounds = 500}
+MPIRUN=${MPIRUN:-mpirun --oversubscribe}
+
+if [ -z "$PARAMETER" ] || [ -z "$VALUES" ]; then
+    echo "Usage: $0 <parameter> \"<values>\" [trials]" >&2
+    exit 1
+fi
+
+# Value of `key` in the base config, `default` if it's not there.
+base_value() {
+    value=$(sed -n "s/^[[:space:]]*$1[[:space:]]*=[[:space:]]*\([0-9]*\).*/\1/p" "$BASE" | tail -n 1)
+    echo "${value:-$2}"
+}
+
+# Base config without the given keys and without any bound.
+base_without() {
+    pattern="rounds|wine_volume|duration|results|seed|transport|actors_per_rank"
+    for key in "$@"; do
+        pattern="$pattern|$key"
+    done
+    grep -Ev "^[[:space:]]*($pattern)[[:space:]]*=" "$BASE" || true
+}
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+for value in $VALUES; do
+    for trial in $(seq 1 "$TRIALS"); do
+        config="$WORKDIR/config.toml"
+        case $PARAMETER in
+            wine_volume_range)
+                base_without min_wine_volume max_wine_volume > "$config"
+                echo "min_wine_volume = ${value%%:*}" >> "$config"
+                echo "max_wine_volume = ${value##*:}" >> "$config"
+                echo 'transport = "mpi"' >> "$config"
+                ;;
+            processes)
+                base_without > "$config"
+                echo 'transport = "hybrid"' >> "$config"
+                ;;
+            *)
+                base_without "$PARAMETER" > "$config"
+                echo "$PARAMETER = $value" >> "$config"
+                echo 'transport = "mpi"' >> "$config"
+                ;;
+        esac
+        echo "$BOUND" >> "$config"
+        echo "seed = $trial" >> "$config"
+        echo "results = \"$RESULTS\"" >> "$config"
+
+        if [ "$PARAMETER" = processes ]; then
+            processes=$value
+        else
+            processes=$(( $(base_value winemaker_count 1) + $(base_value student_count 1) ))
+            case $PARAMETER in
+                winemaker_count) processes=$(( value + $(base_value student_count 1) )) ;;
+                student_count) processes=$(( $(base_value winemaker_count 1) + value )) ;;
+            esac
+        fi
+
+        echo "$PARAMETER = $value, trial $trial/$TRIALS, $processes processes"
+        # Launcher's status would be lost in a pipeline, output goes through a file instead.
+        status=0
+        (cd "$WORKDIR" && $MPIRUN -np "$processes" "$BIN" > output 2>&1) || status=$?
+        if [ "$status" -ne 0 ]; then
+            tail -n 20 "$WORKDIR/output" >&2
+            echo "$PARAMETER = $value, trial $trial/$TRIALS failed with status $status." >&2
+            exit "$status"
+        fi
+        grep '^total:' "$WORKDIR/output"
+    done
+done
+
+echo "Results appended to $RESULTS."
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "message.hpp"
+#include "tags.hpp"
+
+namespace nouveaux::codec {
+
+    // Payload fields that may be present on the wire.
+    // Timestamp is always sent, everything else depends on message type.
+    enum Field : uint8_t {
+        SAFEHOUSE = 0b0001,
+        VOLUME = 0b0010,
+        // Sent as distance from message timestamp, replies always follow the request they refer to.
+        LAST_TIMESTAMP = 0b0100,
+        ORIGIN = 0b1000,
+        RELEASED = 0b10000,
+        // Sent as distance from message timestamp plus one, zero when there is no stamp.
+        STOCKED_AT = 0b100000,
+        BATCH = 0b1000000,
+    };
+
+    // Wire layout of single message type.
+    struct Layout {
+        Message::Type type;
+        // MPI tag, kept per type so that messages can still be filtered by tag.
+        int tag;
+        uint8_t fields;
+        // Human readable name for logs and reports.
+        const char* name;
+    };
+
+    // Indexed by `Message::Type`.
+    constexpr Layout LAYOUTS[] = {
+        { Message::Type::UNKNOWN, UNKNOWN, 0, "UNKNOWN" },
+        { Message::Type::WINEMAKER_REQUEST, WINEMAKER_ACQUIRE_REQ, SAFEHOUSE, "WINEMAKER_REQUEST" },
+        { Message::Type::WINEMAKER_ACKNOWLEDGE, WINEMAKER_ACQUIRE_ACK, SAFEHOUSE, "WINEMAKER_ACKNOWLEDGE" },
+        { Message::Type::WINEMAKER_BROADCAST, WINEMAKER_BROADCAST, SAFEHOUSE | VOLUME | ORIGIN, "WINEMAKER_BROADCAST" },
+        { Message::Type::STUDENT_REQUEST, STUDENT_ACQUIRE_REQ, SAFEHOUSE | STOCKED_AT | BATCH, "STUDENT_REQUEST" },
+        { Message::Type::STUDENT_ACKNOWLEDGE, STUDENT_ACQUIRE_ACK, SAFEHOUSE | VOLUME | LAST_TIMESTAMP | STOCKED_AT | BATCH, "STUDENT_ACKNOWLEDGE" },
+        { Message::Type::STUDENT_BROADCAST, STUDENT_BROADCAST, SAFEHOUSE | ORIGIN, "STUDENT_BROADCAST" },
+        { Message::Type::STUDENT_RELEASE, STUDENT_RELEASE, SAFEHOUSE | VOLUME | LAST_TIMESTAMP, "STUDENT_RELEASE" },
+        { Message::Type::STUDENT_INQUIRE, STUDENT_INQUIRE, SAFEHOUSE | LAST_TIMESTAMP, "STUDENT_INQUIRE" },
+        { Message::Type::STUDENT_RELINQUISH, STUDENT_RELINQUISH, SAFEHOUSE | LAST_TIMESTAMP, "STUDENT_RELINQUISH" },
+        { Message::Type::STUDENT_FAILED, STUDENT_FAILED, SAFEHOUSE | LAST_TIMESTAMP | BATCH, "STUDENT_FAILED" },
+        { Message::Type::TOKEN_REQUEST, TOKEN_REQUEST, SAFEHOUSE | ORIGIN, "TOKEN_REQUEST" },
+        { Message::Type::TOKEN, TOKEN, SAFEHOUSE | VOLUME, "TOKEN" },
+        // Volume and last timestamp belong to the release.
+        { Message::Type::STUDENT_RELEASE_REQUEST, STUDENT_RELEASE_REQ, SAFEHOUSE | VOLUME | LAST_TIMESTAMP | RELEASED | STOCKED_AT | BATCH, "STUDENT_RELEASE_REQUEST" },
+        { Message::Type::DONE, DONE, 0, "DONE" },
+        { Message::Type::FINISH, FINISH, 0, "FINISH" },
+        { Message::Type::LOCK_REQUEST, LOCK_REQUEST, SAFEHOUSE, "LOCK_REQUEST" },
+        { Message::Type::LOCK_GRANT, LOCK_GRANT, SAFEHOUSE | VOLUME, "LOCK_GRANT" },
+        { Message::Type::LOCK_RELEASE, LOCK_RELEASE, SAFEHOUSE | VOLUME, "LOCK_RELEASE" },
+        // Last timestamp is the request's, released is the acknowledged safehouse.
+        { Message::Type::WINEMAKER_ACKNOWLEDGE_REQUEST, WINEMAKER_ACK_REQ, SAFEHOUSE | LAST_TIMESTAMP | RELEASED, "WINEMAKER_ACKNOWLEDGE_REQUEST" },
+    };
+
+    constexpr auto TYPE_COUNT = sizeof(LAYOUTS) / sizeof(Layout);
+
+    constexpr auto layouts_ordered() -> bool {
+        for (size_t i = 0; i < TYPE_COUNT; ++i) {
+            if (static_cast<size_t>(LAYOUTS[i].type) != i)
+                return false;
+        }
+        return true;
+    }
+    static_assert(layouts_ordered(), "LAYOUTS must be indexed by Message::Type");
+
+    // Longest possible LEB128 encoding of 64-bit value.
+    constexpr size_t VARINT_CAPACITY = 10;
+    // Type byte, timestamp and at most seven payload fields.
+    constexpr size_t MAX_SIZE = 1 + 8 * VARINT_CAPACITY;
+
+    [[nodiscard]] constexpr auto layout(Message::Type type) -> const Layout& {
+        auto index = static_cast<size_t>(type);
+        return index < TYPE_COUNT ? LAYOUTS[index] : LAYOUTS[0];
+    }
+
+    inline auto put_varint(uint8_t*& out, uint64_t value) -> void {
+        while (value >= 0x80) {
+            *out++ = static_cast<uint8_t>(value) | 0x80;
+            value >>= 7;
+        }
+        *out++ = static_cast<uint8_t>(value);
+    }
+
+    inline auto get_varint(const uint8_t*& in, const uint8_t* end) -> uint64_t {
+        uint64_t value = 0;
+        for (int shift = 0; in != end && shift < 64; shift += 7) {
+            auto byte = *in++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+        return value;
+    }
+
+    // Writes wire representation of message into `buffer` (at least MAX_SIZE bytes), returns its length.
+    inline auto encode(const Message& message, uint8_t* buffer) -> size_t {
+        const auto& format = layout(message.type);
+        auto out = buffer;
+
+        *out++ = static_cast<uint8_t>(format.type);
+        put_varint(out, message.timestamp);
+        if (format.fields & SAFEHOUSE)
+            put_varint(out, message.payload.safehouse_index);
+        if (format.fields & VOLUME)
+            put_varint(out, message.payload.wine_volume);
+        if (format.fields & LAST_TIMESTAMP)
+            put_varint(out, message.timestamp - message.payload.last_timestamp);
+        if (format.fields & ORIGIN)
+            put_varint(out, message.payload.origin);
+        if (format.fields & RELEASED)
+            put_varint(out, message.payload.released_index);
+        if (format.fields & STOCKED_AT)
+            put_varint(out, message.payload.stocked_at == 0 ? 0 : message.timestamp - message.payload.stocked_at + 1);
+        if (format.fields & BATCH)
+            put_varint(out, message.payload.batch);
+
+        return out - buffer;
+    }
+
+    inline auto decode(const uint8_t* buffer, size_t size, uint64_t sender) -> Message {
+        Message message {};
+        if (size == 0)
+            return message;
+
+        auto in = buffer;
+        auto end = buffer + size;
+        const auto& format = layout(static_cast<Message::Type>(*in++));
+
+        message.type = format.type;
+        message.sender = sender;
+        message.timestamp = get_varint(in, end);
+        if (format.fields & SAFEHOUSE)
+            message.payload.safehouse_index = get_varint(in, end);
+        if (format.fields & VOLUME)
+            message.payload.wine_volume = get_varint(in, end);
+        if (format.fields & LAST_TIMESTAMP)
+            message.payload.last_timestamp = message.timestamp - get_varint(in, end);
+        // Messages that are never forwarded travel on behalf of their sender.
+        message.payload.origin = format.fields & ORIGIN ? get_varint(in, end) : sender;
+        if (format.fields & RELEASED)
+            message.payload.released_index = get_varint(in, end);
+        if (format.fields & STOCKED_AT) {
+            const auto distance = get_varint(in, end);
+            message.payload.stocked_at = distance == 0 ? 0 : message.timestamp - distance + 1;
+        }
+        if (format.fields & BATCH)
+            message.payload.batch = get_varint(in, end);
+
+        return message;
+    }
+}
@@ -13,6 +13,72 @@ namespace nouveaux {
         uint64_t student_count;
         uint32_t min_wine_volume;
         uint32_t max_wine_volume;
+        // Model wine supply and demand are drawn from: "uniform", "zipf", "pareto", "bimodal", "bursts" or "trace".
+        std::string workload;
+        // Parameter of the workload model (see `Workload::Model`), zero picks model's default.
+        double workload_shape;
+        // File of recorded per-actor volumes replayed by "trace" workload.
+        std::string workload_trace;
+        // Distribution of service times: "constant" or "exponential".
+        std::string service_time_model;
+        // Mean seconds winemaker spends stocking safehouse and student taking wine from it, safehouse is held meanwhile.
+        double production_time;
+        double consumption_time;
+        // Policy students choose safehouse with: "first", "random", "largest", "least_recent" or "least_contended".
+        std::string selection;
+        // Most safehouses student acquires together when its demand exceeds the stock of one, one disables batching.
+        uint64_t batch_limit;
+        // Safehouse mutual exclusion: "permission" (quorum for students, winemaker groups), "token" (token per safehouse)
+        // or "manager" (lock granted by winemaker managing the safehouse).
+        std::string exclusion;
+        // Children of every node of the trees broadcasts travel along, zero sends them straight to every receiver.
+        uint64_t broadcast_arity;
+        // Whether winemakers stock any empty safehouse, otherwise (by default) each one stocks only <rank> mod <safehouse count>.
+        bool leasing;
+        // Seconds safehouse has to stay empty before winemakers other than its own one lease it.
+        double lease_patience;
+        // Whether winemakers request their own safehouse again while students drain it (permission exclusion only).
+        bool pipelined;
+        // Number of preposted receive slots of MPI transport.
+        uint64_t receive_slots;
+        // Whether safehouse stock lives in an MPI RMA window (MPI transport without progress thread only). Students then
+        // consume it with one-sided atomics instead of exclusion protocol and winemakers don't broadcast to them.
+        bool stock_table;
+        // Whether MPI transport runs the actor on its own thread, main thread serves as progress thread answering
+        // requests right away.
+        bool progress_thread;
+        // Message transport: "mpi" (actor per rank), "hybrid" (many actors per rank, actor per thread),
+        // "local" (actor per thread, single process) or "simulation" (discrete-event simulation in virtual time).
+        std::string transport;
+        // Number of consecutive actor ids hosted by one rank of hybrid transport, zero spreads them evenly over all ranks.
+        uint64_t actors_per_rank;
+        // Seed of random number generators, actor's generator is seeded with `seed + rank`.
+        // Zero picks random seeds, except in simulation which is always repeatable.
+        uint64_t seed;
+        // Bounds of the run, it stops once every actor met any of them. Zero leaves the run unbounded.
+        // Acquisitions of every actor.
+        uint64_t rounds;
+        // Total wine volume, shared evenly by winemakers (produced) and by students (consumed).
+        uint64_t wine_volume;
+        // Seconds every actor runs (virtual ones when simulated).
+        double duration;
+        // Virtual seconds after which simulation stops.
+        double simulation_duration;
+        // Simulated link latency distribution: "constant", "uniform" or "exponential".
+        std::string latency_model;
+        // Mean simulated latency (seconds) of links within one node and between nodes.
+        double local_latency;
+        double remote_latency;
+        // Number of consecutive actor ids simulated on one node.
+        uint64_t actors_per_node;
+        // Directory of binary per-rank event logs, empty disables them.
+        std::string event_log;
+        // Number of latest log records every actor keeps in memory, zero disables flight recorder.
+        uint64_t flight_recorder;
+        // Directory flight recorders are dumped to.
+        std::string log_directory;
+        // CSV file totals of every finished run are appended to, empty disables it.
+        std::string results;
 
         static auto parse(const std::string& filename) -> Config;
     };
@@ -25,13 +91,75 @@ namespace nouveaux {
         auto student_count = toml::find_or<uint64_t>(src, "student_count", 1);
         auto min_wine_volume = toml::find_or<uint32_t>(src, "min_wine_volume", 1);
         auto max_wine_volume = toml::find_or<uint32_t>(src, "max_wine_volume", 150);
+        auto workload = toml::find_or<std::string>(src, "workload", "uniform");
+        auto workload_shape = toml::find_or<double>(src, "workload_shape", 0.0);
+        auto workload_trace = toml::find_or<std::string>(src, "workload_trace", "");
+        auto service_time_model = toml::find_or<std::string>(src, "service_time_model", "constant");
+        auto production_time = toml::find_or<double>(src, "production_time", 0.0);
+        auto consumption_time = toml::find_or<double>(src, "consumption_time", 0.0);
+        auto selection = toml::find_or<std::string>(src, "selection", "first");
+        auto batch_limit = toml::find_or<uint64_t>(src, "batch_limit", 1);
+        auto exclusion = toml::find_or<std::string>(src, "exclusion", "permission");
+        auto broadcast_arity = toml::find_or<uint64_t>(src, "broadcast_arity", 0);
+        auto leasing = toml::find_or<bool>(src, "leasing", false);
+        auto lease_patience = toml::find_or<double>(src, "lease_patience", 0.005);
+        auto pipelined = toml::find_or<bool>(src, "pipelined", false);
+        auto receive_slots = toml::find_or<uint64_t>(src, "receive_slots", 64);
+        auto stock_table = toml::find_or<bool>(src, "stock_table", false);
+        auto progress_thread = toml::find_or<bool>(src, "progress_thread", false);
+        auto transport = toml::find_or<std::string>(src, "transport", "mpi");
+        auto actors_per_rank = toml::find_or<uint64_t>(src, "actors_per_rank", 0);
+        auto seed = toml::find_or<uint64_t>(src, "seed", 0);
+        auto rounds = toml::find_or<uint64_t>(src, "rounds", 0);
+        auto wine_volume = toml::find_or<uint64_t>(src, "wine_volume", 0);
+        auto duration = toml::find_or<double>(src, "duration", 0.0);
+        auto simulation_duration = toml::find_or<double>(src, "simulation_duration", 10.0);
+        auto latency_model = toml::find_or<std::string>(src, "latency_model", "constant");
+        auto local_latency = toml::find_or<double>(src, "local_latency", 0.00005);
+        auto remote_latency = toml::find_or<double>(src, "remote_latency", 0.001);
+        auto actors_per_node = toml::find_or<uint64_t>(src, "actors_per_node", 1);
+        auto event_log = toml::find_or<std::string>(src, "event_log", "");
+        auto flight_recorder = toml::find_or<uint64_t>(src, "flight_recorder", 1024);
+        auto log_directory = toml::find_or<std::string>(src, "log_directory", "logs");
+        auto results = toml::find_or<std::string>(src, "results", "");
 
         return Config {
             safehouse_count,
             winemaker_count,
             student_count,
             min_wine_volume,
-            max_wine_volume
+            max_wine_volume,
+            workload,
+            workload_shape,
+            workload_trace,
+            service_time_model,
+            production_time,
+            consumption_time,
+            selection,
+            batch_limit,
+            exclusion,
+            broadcast_arity,
+            leasing,
+            lease_patience,
+            pipelined,
+            receive_slots,
+            stock_table,
+            progress_thread,
+            transport,
+            actors_per_rank,
+            seed,
+            rounds,
+            wine_volume,
+            duration,
+            simulation_duration,
+            latency_model,
+            local_latency,
+            remote_latency,
+            actors_per_node,
+            event_log,
+            flight_recorder,
+            log_directory,
+            results
         };
     }
 }
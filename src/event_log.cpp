@@ -0,0 +1,93 @@
+#include "event_log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "message.hpp"
+
+namespace nouveaux {
+
+    namespace {
+        thread_local EventLog* __current = nullptr;
+    }
+
+    EventLog::EventLog(const std::string& directory, uint32_t rank, const std::string& suffix)
+      : __path(fmt::format("{}/events_{}{}.bin", directory, rank, suffix)),
+        __buffer({}),
+        __rank(rank),
+        __clock(0) {
+        std::filesystem::create_directories(directory);
+
+        Header header {};
+        std::copy(std::begin(MAGIC), std::end(MAGIC), header.magic);
+        header.version = VERSION;
+        header.record_size = sizeof(Record);
+
+        // Log is reopened on every flush, so that thousands of simulated actors don't hold a descriptor each.
+        if (auto file = std::fopen(__path.c_str(), "wb")) {
+            std::fwrite(&header, sizeof(header), 1, file);
+            std::fclose(file);
+        }
+    }
+
+    EventLog::~EventLog() {
+        flush();
+    }
+
+    auto EventLog::sent(const Message& message, uint32_t receiver, uint32_t receivers) -> void {
+        __clock = std::max(__clock, message.timestamp);
+        append(__clock, SEND, receiver, receivers, message);
+    }
+
+    auto EventLog::received(const Message& message) -> void {
+        __clock = std::max(__clock, message.timestamp) + 1;
+        append(__clock, RECEIVE, message.sender, 1, message);
+    }
+
+    auto EventLog::flush() -> void {
+        if (__buffer.empty()) {
+            return;
+        }
+
+        if (auto file = std::fopen(__path.c_str(), "ab")) {
+            std::fwrite(__buffer.data(), sizeof(Record), __buffer.size(), file);
+            std::fclose(file);
+        }
+        __buffer.clear();
+    }
+
+    auto EventLog::append(uint64_t clock, uint8_t kind, uint32_t peer, uint32_t receivers, const Message& message) -> void {
+        if (__buffer.capacity() == 0) {
+            __buffer.reserve(BUFFER_RECORDS);
+        }
+
+        __buffer.push_back(Record {
+            clock,
+            message.timestamp,
+            message.payload.safehouse_index,
+            message.payload.wine_volume,
+            message.payload.last_timestamp,
+            __rank,
+            peer,
+            kind,
+            static_cast<uint8_t>(message.type),
+            0,
+            receivers,
+        });
+
+        if (__buffer.size() == BUFFER_RECORDS) {
+            flush();
+        }
+    }
+
+    auto EventLog::bind(EventLog* log) -> void {
+        __current = log;
+    }
+
+    auto EventLog::current() -> EventLog* {
+        return __current;
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nouveaux {
+
+    struct Message;
+
+    // Binary trace of every message one actor sent or received, `events_<rank>.bin` in log directory.
+    // Requests transport progress thread answers for the actor, with the answers, go to `events_<rank>.progress.bin`.
+    //
+    // File is a `Header` followed by fixed size `Record`s in order of their `clock`, so traces of all
+    // ranks can be merged into one Lamport-ordered trace by `tools/eventmerge.cpp` without parsing.
+    class EventLog {
+      public:
+        static constexpr char MAGIC[8] = { 'N', 'V', 'X', 'E', 'V', 'T', 0, 0 };
+        static constexpr uint32_t VERSION = 1;
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            // Size of single record, lets readers reject files of different layout.
+            uint32_t record_size;
+        };
+
+        enum Kind : uint8_t {
+            SEND,
+            RECEIVE,
+        };
+
+        // Receiver of messages sent to a fan-out.
+        static constexpr uint32_t FANOUT = UINT32_MAX;
+
+        struct Record {
+            // Lamport time of the event on `rank`. Mirrors actor's clock: sends carry their own timestamp,
+            // receives happen one tick after both the message and everything logged before on this rank.
+            // Non-decreasing within a file, sends share the clock of the event before them when the message
+            // isn't stamped later. (clock, rank, position in file) is a total order consistent with causality.
+            uint64_t clock;
+            // Message content.
+            uint64_t timestamp;
+            uint64_t safehouse_index;
+            uint64_t wine_volume;
+            uint64_t last_timestamp;
+            // Owner of the log.
+            uint32_t rank;
+            // Receiver (or FANOUT) for sends, sender for receives.
+            uint32_t peer;
+            uint8_t kind;
+            // `Message::Type`.
+            uint8_t type;
+            uint16_t reserved;
+            // Number of receivers of fan-out sends, one otherwise.
+            uint32_t receivers;
+        };
+
+        // Records kept in memory between writes.
+        static constexpr size_t BUFFER_RECORDS = 512;
+
+      private:
+        std::string __path;
+        std::vector<Record> __buffer;
+        const uint32_t __rank;
+        uint64_t __clock;
+
+      public:
+        // Creates (or truncates) log of `rank` in `directory`, other threads of the same rank log with a `suffix`.
+        EventLog(const std::string& directory, uint32_t rank, const std::string& suffix = "");
+        EventLog(const EventLog&) = delete;
+        auto operator=(const EventLog&) -> EventLog& = delete;
+        ~EventLog();
+
+        auto sent(const Message& message, uint32_t receiver, uint32_t receivers) -> void;
+        auto received(const Message& message) -> void;
+        auto flush() -> void;
+
+        // Makes `log` the one written by actor on calling thread, `nullptr` disables logging.
+        static auto bind(EventLog* log) -> void;
+        [[nodiscard]] static auto current() -> EventLog*;
+
+      private:
+        auto append(uint64_t clock, uint8_t kind, uint32_t peer, uint32_t receivers, const Message& message) -> void;
+    };
+}
@@ -0,0 +1,79 @@
+#include "exclusion.hpp"
+
+#include <algorithm>
+
+#include "overlay.hpp"
+#include "termination.hpp"
+
+namespace nouveaux {
+
+    auto Exclusion::mode_of(const std::string& name) -> Mode {
+        if (name == "token")
+            return Mode::TOKEN;
+        if (name == "manager")
+            return Mode::MANAGER;
+        return Mode::PERMISSION;
+    }
+
+    Exclusion::Exclusion(std::atomic<uint64_t>& clock, uint32_t rank)
+      : __clock(clock),
+        __rank(rank),
+        __loopback({}) {}
+
+    auto Exclusion::receive() -> Message {
+        flush();
+        const auto termination = Termination::current();
+        const auto overlay = Overlay::current();
+        while (true) {
+            Message message;
+            if (!__loopback.empty()) {
+                message = __loopback.front();
+                __loopback.pop_front();
+            } else {
+                message = Message::receive_from(ANY_SOURCE);
+            }
+
+            tick(message.timestamp);
+            // Termination messages never reach the protocol, FINISH unwinds the actor right here.
+            if (termination == nullptr || !termination->handle(message)) {
+                // Broadcast travelling a tree goes on to the rest of its subtree before anyone acts on it.
+                if (overlay != nullptr) {
+                    overlay->forward(message);
+                }
+                return message;
+            }
+        }
+    }
+
+    auto Exclusion::acquire_batch(const std::vector<uint64_t>& safehouses, const Observer& observer, const Enter& enter) -> uint64_t {
+        uint64_t entered = 0;
+        for (auto&& safehouse : safehouses) {
+            if (!acquire(safehouse, observer)) {
+                break;
+            }
+            ++entered;
+            const auto more = enter(safehouse);
+            release();
+            if (!more) {
+                break;
+            }
+        }
+        return entered;
+    }
+
+    auto Exclusion::tick(uint64_t timestamp) -> uint64_t {
+        auto clock = __clock.load(std::memory_order_relaxed);
+        auto next = std::max(clock, timestamp) + 1;
+        while (!__clock.compare_exchange_weak(clock, next, std::memory_order_relaxed))
+            next = std::max(clock, timestamp) + 1;
+        return next;
+    }
+
+    auto Exclusion::send(Message message, uint64_t receiver) -> void {
+        if (receiver == __rank) {
+            __loopback.push_back(message);
+        } else {
+            message.send_to(receiver);
+        }
+    }
+}
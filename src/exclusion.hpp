@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "message.hpp"
+
+namespace nouveaux {
+
+    // Mutual exclusion on safehouses, as seen by a single actor.
+    //
+    // Actor owns the protocol state together with its Lamport clock, every message actor receives
+    // has to go through `receive` and then `handle`, so that the protocol can answer its peers while
+    // the actor is busy with something else.
+    class Exclusion {
+      public:
+        enum class Mode {
+            // Permissions collected from peers: quorum (Maekawa) for students, winemakers sharing
+            // safehouse (Ricart-Agrawala) for winemakers.
+            PERMISSION,
+            // Single token per safehouse, carrying its stock, requests forwarded to the holder (Naimi-Trehel).
+            TOKEN,
+            // Lock granted by manager of the safehouse, which keeps its stock, managers are the winemakers.
+            MANAGER,
+        };
+
+        // Stock of messages which don't carry any.
+        static constexpr uint64_t NO_STOCK = UINT64_MAX;
+
+        // Unknown names fall back to PERMISSION.
+        [[nodiscard]] static auto mode_of(const std::string& name) -> Mode;
+
+        // Sees every message received while acquiring (after the protocol handled it).
+        // Returning true asks to abandon acquisition, protocols that cannot withdraw a request ignore it.
+        using Observer = std::function<bool(const Message&)>;
+        // Runs while batched safehouse is held, returns whether the rest of the batch is still needed.
+        using Enter = std::function<bool(uint64_t)>;
+
+      protected:
+        // Lamport clock of the owning actor.
+        //
+        // MUTABILITY: Shared with the actor and the transport progress thread, all advance it on their own events.
+        //     Only read-modify-writes move it, so stamps taken on either thread are never lower than earlier ones.
+        std::atomic<uint64_t>& __clock;
+        // Process's own id.
+        const uint32_t __rank;
+        // Messages addressed to self, handled before any message from the network.
+        std::deque<Message> __loopback;
+
+      public:
+        Exclusion(std::atomic<uint64_t>& clock, uint32_t rank);
+        Exclusion(const Exclusion&) = delete;
+        auto operator=(const Exclusion&) -> Exclusion& = delete;
+        virtual ~Exclusion() = default;
+
+        // Next message for this actor, advances Lamport clock. Anything held back is sent first, broadcasts
+        // travelling a tree are passed on. Throws `Termination::Finished` once bounded run is over.
+        auto receive() -> Message;
+        // Answers protocol messages, anything else is left to the actor.
+        virtual auto handle(const Message& message) -> void = 0;
+
+        // Blocks until `safehouse` is held, returns false if acquisition was abandoned.
+        [[nodiscard]] virtual auto acquire(uint64_t safehouse, const Observer& observer) -> bool = 0;
+        // Requests all `safehouses` (without duplicates) at once and calls `enter` for each one as soon as
+        // it's held, the safehouse is released when `enter` returns. None is held while waiting for another,
+        // so batches never deadlock. `enter` returning false (or observer abandoning) withdraws requests
+        // still pending. Returns number of safehouses entered.
+        //
+        // Default requests them one after another, protocols able to keep more requests pending override it.
+        [[nodiscard]] virtual auto acquire_batch(const std::vector<uint64_t>& safehouses, const Observer& observer, const Enter& enter) -> uint64_t;
+        virtual auto release() -> void = 0;
+        // Stock of the held safehouse if protocol carries it along, nullptr otherwise.
+        [[nodiscard]] virtual auto stock() -> uint64_t* { return nullptr; }
+        // Stock left in the held safehouse, protocols telling peers about it on release keep it until then.
+        virtual auto report(uint64_t /* stock */) -> void {}
+
+      protected:
+        // Moves clock past both its value and `timestamp`, returns the new value. Safe on progress thread.
+        auto tick(uint64_t timestamp) -> uint64_t;
+        auto send(Message message, uint64_t receiver) -> void;
+        // Sends messages held back to piggyback them on later ones, actor may block afterwards.
+        virtual auto flush() -> void {}
+    };
+}
@@ -0,0 +1,315 @@
+#include "group_exclusion.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "logger.hpp"
+#include "metrics.hpp"
+#include "termination.hpp"
+
+#define format(fmt) "[{:0>10}] WINEMAKER #{} " fmt, __clock.load(std::memory_order_relaxed), __rank
+
+namespace nouveaux {
+    namespace {
+        auto group_of(uint32_t rank, uint64_t safehouse_count, uint64_t winemakers_start_id, uint64_t winemakers_count, bool leasing) -> std::vector<uint64_t> {
+            std::vector<uint64_t> group;
+            for (auto winemaker = winemakers_start_id; winemaker < winemakers_start_id + winemakers_count; ++winemaker) {
+                if (winemaker != rank && (leasing || winemaker % safehouse_count == rank % safehouse_count)) {
+                    group.push_back(winemaker);
+                }
+            }
+            return group;
+        }
+    }
+
+    GroupExclusion::GroupExclusion(std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t winemakers_start_id, uint64_t winemakers_count, bool leasing)
+      : Exclusion(clock, rank),
+        __safehouse(NONE),
+        __group(group_of(rank, safehouse_count, winemakers_start_id, winemakers_count, leasing)),
+        __leases(safehouse_count),
+        __unhandled(__group.size(), 0),
+        __held_acks({}),
+        __mutex() {
+        Transport::current().respond_with([this](const Message& message) { return respond(message); });
+    }
+
+    GroupExclusion::~GroupExclusion() {
+        Transport::current().respond_with(nullptr);
+    }
+
+    auto GroupExclusion::acquire(uint64_t safehouse, const Observer& observer) -> bool {
+        std::unique_lock<std::mutex> lock(__mutex);
+        __safehouse = safehouse;
+        auto& lease = __leases[safehouse];
+        if (lease.priority != 0) {
+            // Abandoned request is still pending, it just becomes ours again.
+            lease.abandoned = false;
+        } else {
+            // Nobody holds any permission at first, first request of every pair collects it.
+            lease.permissions.resize(__group.size(), false);
+            lease.priority = ++__clock;
+            lease.asked = false;
+            for (size_t member = 0; member < __group.size(); ++member) {
+                if (!lease.permissions[member]) {
+                    send_req(safehouse, __group[member]);
+                }
+            }
+        }
+
+        // Safehouse requested while still held is entered only once students empty it.
+        while (lease.permission_count < __group.size() || lease.held) {
+            lock.unlock();
+            auto message = receive();
+            handle(message);
+            const auto abandon = observer(message);
+            lock.lock();
+            if (abandon) {
+                lease.abandoned = true;
+                __safehouse = NONE;
+                return false;
+            }
+            trace(format("PERMISSIONS: {}"), lease.permission_count);
+        }
+
+        enter(safehouse);
+        // Nothing is received while safehouse is stocked.
+        flush();
+        return true;
+    }
+
+    auto GroupExclusion::release() -> void {
+        std::lock_guard<std::mutex> lock(__mutex);
+        __leases[__safehouse].released = true;
+        __safehouse = NONE;
+    }
+
+    auto GroupExclusion::enter(uint64_t safehouse) -> void {
+        auto& lease = __leases[safehouse];
+        lease.priority = 0;
+        if (lease.abandoned) {
+            lease.abandoned = false;
+            // Requests deferred because of the lease still wait for students.
+            if (!lease.held) {
+                send_pending_acks(safehouse);
+            }
+            return;
+        }
+        if (!lease.asked && !__group.empty()) {
+            ++Metrics::current().reuses;
+        }
+        lease.held = true;
+        lease.released = false;
+    }
+
+    auto GroupExclusion::flush() -> void {
+        for (auto&& [receiver, ack] : __held_acks) {
+            ack.send_to(receiver);
+        }
+        __held_acks.clear();
+    }
+
+    auto GroupExclusion::split(const Message& message) -> std::pair<Message, Message> {
+        Message ack {
+            /* .type = */ Message::Type::WINEMAKER_ACKNOWLEDGE,
+            /* .sender = */ message.sender,
+            /* .timestamp = */ message.timestamp,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ message.payload.released_index,
+              /* .wine_volume = */ 0,
+              /* .last_timestamp = */ 0,
+              /* .origin = */ message.payload.origin,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            }
+        };
+        Message request {
+            /* .type = */ Message::Type::WINEMAKER_REQUEST,
+            /* .sender = */ message.sender,
+            /* .timestamp = */ message.payload.last_timestamp,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ message.payload.safehouse_index,
+              /* .wine_volume = */ 0,
+              /* .last_timestamp = */ 0,
+              /* .origin = */ message.payload.origin,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            }
+        };
+        return { ack, request };
+    }
+
+    auto GroupExclusion::handle(const Message& message) -> void {
+        std::lock_guard<std::mutex> lock(__mutex);
+        if (const auto member = member_of(message.sender); member < __group.size() && __unhandled[member] > 0) {
+            --__unhandled[member];
+        }
+        dispatch(message);
+    }
+
+    auto GroupExclusion::dispatch(const Message& message) -> void {
+        switch (message.type) {
+            case Message::Type::WINEMAKER_ACKNOWLEDGE: {
+                debug(format("received WINEMAKER ACKNOWLEDGE {{ timestamp: {}, sender: {}, safehouse: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index);
+                const auto safehouse = message.payload.safehouse_index;
+                auto& lease = __leases[safehouse];
+                const auto member = member_of(message.sender);
+                lease.permissions.resize(__group.size(), false);
+                if (member < __group.size() && !lease.permissions[member]) {
+                    lease.permissions[member] = true;
+                    ++lease.permission_count;
+                }
+                if (lease.abandoned && lease.permission_count == __group.size()) {
+                    enter(safehouse);
+                }
+                break;
+            }
+            case Message::Type::WINEMAKER_REQUEST:
+                debug(format("received WINEMAKER REQUEST {{ timestamp: {}, sender: {}, safehouse: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index);
+                arbitrate(message);
+                break;
+            case Message::Type::WINEMAKER_ACKNOWLEDGE_REQUEST: {
+                const auto [ack, request] = split(message);
+                dispatch(ack);
+                dispatch(request);
+                break;
+            }
+            case Message::Type::STUDENT_BROADCAST: {
+                const auto safehouse = message.payload.safehouse_index;
+                auto& lease = __leases[safehouse];
+                if (lease.held && lease.released) {
+                    Metrics::current().pending_acks.record(lease.pending_acks.size());
+                    lease.held = false;
+                    lease.released = false;
+                    send_pending_acks(safehouse);
+                    if (lease.abandoned && lease.permission_count == __group.size()) {
+                        enter(safehouse);
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    auto GroupExclusion::respond(const Message& message) -> bool {
+        std::lock_guard<std::mutex> lock(__mutex);
+        const auto member = member_of(message.sender);
+        // Termination messages are taken before `handle`, they must not hold back member's requests.
+        if (member == __group.size() || Termination::concerns(message)) {
+            return false;
+        }
+
+        const auto& lease = __leases[message.payload.safehouse_index];
+        const auto idle = message.type == Message::Type::WINEMAKER_REQUEST && !lease.held && lease.priority == 0;
+        if (!idle || __unhandled[member] > 0) {
+            ++__unhandled[member];
+            return false;
+        }
+
+        // Clock is shared with the actor, ACK comes after both the request and everything this rank sent before.
+        debug("[PROGRESS] WINEMAKER #{} answers WINEMAKER REQUEST {{ timestamp: {}, sender: {}, safehouse: {} }}", __rank, message.timestamp, message.sender, message.payload.safehouse_index);
+        // Request never reaches the actor, it's counted and logged here.
+        message.received();
+        send_ack(message.payload.safehouse_index, message.sender, tick(message.timestamp), true);
+        return true;
+    }
+
+    auto GroupExclusion::arbitrate(const Message& request) -> void {
+        const auto safehouse = request.payload.safehouse_index;
+        auto& lease = __leases[safehouse];
+        // Earlier request wins, ties are broken by lower rank.
+        const auto precedes = request.timestamp < lease.priority || (request.timestamp == lease.priority && request.sender < __rank);
+        if (lease.held || (lease.priority != 0 && !precedes)) {
+            lease.pending_acks.emplace_back(request);
+            return;
+        }
+
+        const auto member = member_of(request.sender);
+        const auto had_permission = member < lease.permissions.size() && lease.permissions[member];
+        send_ack(safehouse, request.sender, ++__clock, false);
+        // Permission given up while requesting has to be asked for again, otherwise the request already went out.
+        if (lease.priority != 0 && had_permission) {
+            send_req(safehouse, request.sender);
+        }
+    }
+
+    auto GroupExclusion::send_req(uint64_t safehouse, uint64_t receiver) -> void {
+        __leases[safehouse].asked = true;
+        ++__clock;
+        Message request {
+            /* .type = */ Message::Type::WINEMAKER_REQUEST,
+            /* .sender = */ __rank,
+            /* .timestamp = */ __leases[safehouse].priority,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ safehouse,
+              /* .wine_volume = */ 0,
+              /* .last_timestamp = */ 0,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            },
+        };
+
+        // ACK held for the receiver goes along, the one of the same safehouse has to come first.
+        auto held = std::find_if(__held_acks.begin(), __held_acks.end(), [&](auto&& ack) { return ack.first == receiver && ack.second.payload.safehouse_index == safehouse; });
+        if (held == __held_acks.end()) {
+            held = std::find_if(__held_acks.begin(), __held_acks.end(), [&](auto&& ack) { return ack.first == receiver; });
+        }
+        if (held != __held_acks.end()) {
+            request.type = Message::Type::WINEMAKER_ACKNOWLEDGE_REQUEST;
+            request.timestamp = std::max(held->second.timestamp, request.timestamp);
+            request.payload.last_timestamp = __leases[safehouse].priority;
+            request.payload.released_index = held->second.payload.safehouse_index;
+            __held_acks.erase(held);
+        }
+        request.send_to(receiver);
+    }
+
+    auto GroupExclusion::send_ack(uint64_t safehouse, uint64_t receiver, uint64_t timestamp, bool now) -> void {
+        auto& lease = __leases[safehouse];
+        const auto member = member_of(receiver);
+        if (member < lease.permissions.size() && lease.permissions[member]) {
+            lease.permissions[member] = false;
+            --lease.permission_count;
+        }
+
+        Message ack {
+            /* .type = */ Message::Type::WINEMAKER_ACKNOWLEDGE,
+            /* .sender = */ __rank,
+            /* .timestamp = */ timestamp,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ safehouse,
+              /* .wine_volume = */ 0,
+              /* .last_timestamp = */ 0,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            },
+        };
+
+        if (!now) {
+            __held_acks.emplace_back(receiver, ack);
+            return;
+        }
+        ack.send_to(receiver);
+    }
+
+    auto GroupExclusion::send_pending_acks(uint64_t safehouse) -> void {
+        // Requests losing to our own pending one get deferred again.
+        auto pending = std::move(__leases[safehouse].pending_acks);
+        __leases[safehouse].pending_acks.clear();
+        for (auto&& m : pending) {
+            arbitrate(m);
+        }
+    }
+
+    auto GroupExclusion::member_of(uint64_t rank) const -> size_t {
+        const auto member = std::lower_bound(__group.begin(), __group.end(), rank);
+        return member != __group.end() && *member == rank ? member - __group.begin() : __group.size();
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "exclusion.hpp"
+
+namespace nouveaux {
+
+    // Winemakers' permission protocol: Ricart-Agrawala among winemakers which may stock the same
+    // safehouse, with Roucairol-Carvalho reuse of permissions.
+    //
+    // Permission granted by a peer stays valid until that peer requests the safehouse itself, so
+    // winemaker acquiring again only asks peers which requested in the meantime.
+    //
+    // Acquired safehouse is leased for the whole time it's stocked, `release` only marks it as handed
+    // over to students and deferred ACKs go out once it's reported empty (STUDENT_BROADCAST).
+    // Leases of different safehouses are independent, winemaker may hold many at once.
+    //
+    // Held safehouse may be requested again, permissions are then collected while students drain it
+    // and the next lease starts as soon as it's reported empty.
+    //
+    // ACKs sent by the actor are held back until it blocks or enters a safehouse, one going to a peer the
+    // next REQ goes to is piggybacked on it (WINEMAKER_ACKNOWLEDGE_REQUEST). Deferred ACKs sent once
+    // safehouse is reported empty are usually followed by the request for it.
+    //
+    // With transport progress thread, requests for safehouses neither held nor requested are answered
+    // there right away. State is then shared between the threads and guarded by `__mutex`.
+    class GroupExclusion : public Exclusion {
+#if defined(NOUVEAUX_DEBUG)
+      public:
+#endif
+        struct Lease {
+            // Lamport clock state for last sent REQ message, zero when there is no pending request.
+            uint64_t priority;
+            // Whether any REQ went out for pending request, entering without one reuses permissions.
+            bool asked;
+            // Whether pending request was abandoned, it's released as soon as it collects all permissions.
+            // Answering deferred requests right away could leave both sides of crossing ACKs with permission.
+            bool abandoned;
+            // Whether safehouse is held, from acquisition until students empty it.
+            bool held;
+            // Whether `release` was called for held safehouse.
+            bool released;
+            // Whether permission of corresponding `__group` member is held, empty until first request.
+            std::vector<bool> permissions;
+            // Number of permissions held.
+            uint64_t permission_count;
+            // Requests to be acknowledged once safehouse is emptied or own request is done.
+            std::vector<Message> pending_acks;
+        };
+        // Safehouse currently requested or last acquired, NONE when there is none.
+        //
+        // MUTABILITY: Should change only when acquisition starts or is abandoned and when safehouse is released.
+        uint64_t __safehouse;
+        // Winemakers which may stock the same safehouses (excluding self), sorted.
+        // Only those can ever conflict, so REQ/ACK exchange is limited to this group.
+        const std::vector<uint64_t> __group;
+        // Per safehouse lease state.
+        //
+        // MUTABILITY: Should change only when safehouse is acquired or released, or received
+        //     WINEMAKER_REQUEST, WINEMAKER_ACKNOWLEDGE or STUDENT_BROADCAST for it.
+        std::vector<Lease> __leases;
+        // Messages of corresponding `__group` member received but not handled yet. Progress thread answers
+        // member's request only when there are none, otherwise it could overtake a message changing permissions.
+        //
+        // MUTABILITY: Should change only when message of a member is passed to the actor or handled.
+        std::vector<uint64_t> __unhandled;
+        // ACKs waiting for the next REQ to the same peer together with their receivers, in order they were given.
+        //
+        // MUTABILITY: Should change only when actor gives up permission and when ACK is sent, never by progress thread.
+        std::vector<std::pair<uint64_t, Message>> __held_acks;
+        // Guards all of the above once progress thread may answer requests.
+        std::mutex __mutex;
+
+      public:
+        static constexpr uint64_t NONE = UINT64_MAX;
+
+        // With `leasing` every winemaker may stock any safehouse, otherwise only <winemakers id> mod <safehouse count>.
+        GroupExclusion(std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t winemakers_start_id, uint64_t winemakers_count, bool leasing);
+        ~GroupExclusion() override;
+
+        auto handle(const Message& message) -> void override;
+        // Observer may abandon acquisition, request then completes in background and is released right away.
+        [[nodiscard]] auto acquire(uint64_t safehouse, const Observer& observer) -> bool override;
+        auto release() -> void override;
+
+        // ACK and REQ carried by WINEMAKER_ACKNOWLEDGE_REQUEST, in the order they take effect.
+        [[nodiscard]] static auto split(const Message& message) -> std::pair<Message, Message>;
+
+      protected:
+        auto flush() -> void override;
+
+      private:
+        // Handles message of any type once state is locked.
+        auto dispatch(const Message& message) -> void;
+        // Progress thread side, answers request if nothing has to be arbitrated. Returns whether it did.
+        [[nodiscard]] auto respond(const Message& message) -> bool;
+        // All permissions of `safehouse` were collected.
+        auto enter(uint64_t safehouse) -> void;
+        // Acknowledges `request` right away or defers it until lease ends or own request is done.
+        auto arbitrate(const Message& request) -> void;
+        auto send_req(uint64_t safehouse, uint64_t receiver) -> void;
+        // Gives up permission of `receiver` for `safehouse`, ACK is held back for the next REQ unless `now`.
+        auto send_ack(uint64_t safehouse, uint64_t receiver, uint64_t timestamp, bool now) -> void;
+        auto send_pending_acks(uint64_t safehouse) -> void;
+        [[nodiscard]] auto member_of(uint64_t rank) const -> size_t;
+    };
+}
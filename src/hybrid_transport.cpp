@@ -0,0 +1,173 @@
+#include "hybrid_transport.hpp"
+
+#include <thread>
+
+#include "codec.hpp"
+
+namespace nouveaux {
+
+    auto HybridTransport::send(const Message& message, uint64_t receiver) -> void {
+        if (__node.placement().rank_of(receiver) == __node.rank()) {
+            __node.network().mailbox(receiver - __node.first()).push(message);
+        } else {
+            __node.post({ message, { receiver } });
+        }
+    }
+
+    auto HybridTransport::send(const Message& message, Fanout& fanout) -> void {
+        auto& state = fanout.state();
+        if (!state) {
+            auto routes = std::make_unique<Routes>();
+            for (auto&& receiver : fanout.receivers()) {
+                const auto rank = __node.placement().rank_of(receiver);
+                if (rank == __node.rank()) {
+                    routes->local.push_back(receiver - __node.first());
+                    continue;
+                }
+                if (routes->remote.empty() || __node.placement().rank_of(routes->remote.back().front()) != rank) {
+                    routes->remote.emplace_back();
+                }
+                routes->remote.back().push_back(receiver);
+            }
+            state = std::move(routes);
+        }
+
+        const auto& routes = static_cast<const Routes&>(*state);
+        for (auto&& receiver : routes.local) {
+            __node.network().mailbox(receiver).push(message);
+        }
+        for (auto&& receivers : routes.remote) {
+            __node.post({ message, receivers });
+        }
+    }
+
+    HybridTransport::Node::Node(const Placement& placement, uint64_t rank)
+      : __placement(placement),
+        __rank(rank),
+        __network(placement.count(rank)),
+        __outbox(),
+        __send_buffers({}),
+        __sends({}),
+        __free_sends({}),
+        __reclaimed({}),
+        __receive_buffer({}),
+        __sent(0),
+        __received(0) {}
+
+    HybridTransport::Node::~Node() {
+        MPI_Waitall(__sends.size(), __sends.data(), MPI_STATUSES_IGNORE);
+    }
+
+    auto HybridTransport::Node::serve(const std::atomic<uint64_t>& running) -> void {
+        uint64_t idle = 0;
+        while (running.load(std::memory_order_acquire) != 0) {
+            const auto busy = flush() | poll();
+            // Actors park on their mailboxes, only this thread keeps spinning. Yield once there is nothing to do.
+            idle = busy ? 0 : idle + 1;
+            if (idle > 64) {
+                std::this_thread::yield();
+            }
+        }
+        flush();
+    }
+
+    auto HybridTransport::Node::drain() -> void {
+        uint64_t total[] = { 1, 0 };
+        while (total[0] != total[1]) {
+            while (flush() | poll()) {
+            }
+            uint64_t counts[] = { __sent, __received };
+            MPI_Allreduce(counts, total, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        }
+    }
+
+    auto HybridTransport::Node::flush() -> bool {
+        auto busy = false;
+        Envelope envelope;
+        while (__outbox.try_pop(envelope)) {
+            busy = true;
+            const auto& layout = codec::layout(envelope.message.type);
+            if (layout.tag == UNKNOWN) {
+                continue;
+            }
+
+            if (__free_sends.empty()) {
+                reclaim_sends();
+            }
+            if (__free_sends.empty()) {
+                __send_buffers.emplace_back();
+                __sends.push_back(MPI_REQUEST_NULL);
+                __free_sends.push_back(__sends.size() - 1);
+            }
+
+            // Frame: sender, number of receivers, receivers and the encoded message.
+            auto index = __free_sends.back();
+            __free_sends.pop_back();
+            auto& buffer = __send_buffers[index];
+            buffer.resize((envelope.receivers.size() + 2) * codec::VARINT_CAPACITY + codec::MAX_SIZE);
+            auto out = buffer.data();
+            codec::put_varint(out, envelope.message.sender);
+            codec::put_varint(out, envelope.receivers.size());
+            for (auto&& receiver : envelope.receivers) {
+                codec::put_varint(out, receiver);
+            }
+            out += codec::encode(envelope.message, out);
+
+            const auto size = static_cast<int>(out - buffer.data());
+            const auto rank = static_cast<int>(__placement.rank_of(envelope.receivers.front()));
+            ++__sent;
+            MPI_Isend(buffer.data(), size, MPI_BYTE, rank, layout.tag, MPI_COMM_WORLD, &__sends[index]);
+        }
+        return busy;
+    }
+
+    auto HybridTransport::Node::poll() -> bool {
+        auto busy = false;
+        while (true) {
+            int arrived = 0;
+            MPI_Status status;
+            MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &arrived, &status);
+            if (!arrived) {
+                return busy;
+            }
+            busy = true;
+
+            // Probing any tag picks the oldest message of every sender, receiving exactly it keeps FIFO order.
+            int size = 0;
+            MPI_Get_count(&status, MPI_BYTE, &size);
+            __receive_buffer.resize(size);
+            MPI_Recv(__receive_buffer.data(), size, MPI_BYTE, status.MPI_SOURCE, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            ++__received;
+
+            const uint8_t* in = __receive_buffer.data();
+            const auto end = in + size;
+            const auto sender = codec::get_varint(in, end);
+            auto receivers = codec::get_varint(in, end);
+            // Receivers precede the message, decode it first and deliver afterwards.
+            const auto listed = in;
+            for (auto skipped = receivers; skipped > 0; --skipped) {
+                codec::get_varint(in, end);
+            }
+            const auto message = codec::decode(in, end - in, sender);
+
+            in = listed;
+            for (; receivers > 0; --receivers) {
+                __network.mailbox(codec::get_varint(in, end) - first()).push(message);
+            }
+        }
+    }
+
+    auto HybridTransport::Node::reclaim_sends() -> void {
+        __reclaimed.resize(__sends.size());
+
+        int count = 0;
+        MPI_Testsome(__sends.size(), __sends.data(), &count, __reclaimed.data(), MPI_STATUSES_IGNORE);
+        if (count == MPI_UNDEFINED) {
+            return;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            __free_sends.push_back(__reclaimed[i]);
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <mpi.h>
+
+#include "local_transport.hpp"
+#include "mailbox.hpp"
+
+namespace nouveaux {
+
+    // Hybrid transport, many actors per MPI rank, every one on its own thread.
+    //
+    // Actors hosted by the same rank exchange messages through their mailboxes exactly like `LocalTransport`.
+    // Messages for actors on other ranks are queued for the rank's communication thread, the only one making
+    // MPI calls (`MPI_THREAD_FUNNELED` suffices), which also routes frames received from other ranks into
+    // local mailboxes. Fan-out sends one frame per remote rank, listing all its receivers.
+    class HybridTransport : public LocalTransport {
+      public:
+        // Actors distributed over ranks in blocks of consecutive ids, computed alike by every rank at startup.
+        class Placement {
+            uint64_t __actors;
+            uint64_t __block;
+
+          public:
+            // Zero `actors_per_rank` spreads actors evenly over all `ranks`.
+            Placement(uint64_t actors, uint64_t ranks, uint64_t actors_per_rank)
+              : __actors(actors),
+                __block(actors_per_rank != 0 ? actors_per_rank : (actors + ranks - 1) / ranks) {}
+
+            [[nodiscard]] auto rank_of(uint64_t actor) const -> uint64_t { return actor / __block; }
+            [[nodiscard]] auto first(uint64_t rank) const -> uint64_t { return std::min(rank * __block, __actors); }
+            [[nodiscard]] auto count(uint64_t rank) const -> uint64_t { return first(rank + 1) - first(rank); }
+            // Number of ranks hosting at least one actor.
+            [[nodiscard]] auto ranks() const -> uint64_t { return (__actors + __block - 1) / __block; }
+        };
+
+        // Message on its way to other rank, all receivers live there.
+        struct Envelope {
+            Message message;
+            std::vector<uint64_t> receivers;
+        };
+
+        // Actors hosted by this rank and its communication endpoint.
+        class Node {
+            const Placement __placement;
+            const uint64_t __rank;
+            // Mailboxes of hosted actors, indexed by actor id minus `first`.
+            LocalTransport::Network __network;
+            // Messages hosted actors sent to other ranks.
+            BasicMailbox<Envelope> __outbox;
+
+            // Communication thread only.
+            std::deque<std::vector<uint8_t>> __send_buffers;
+            std::vector<MPI_Request> __sends;
+            std::vector<int> __free_sends;
+            std::vector<int> __reclaimed;
+            std::vector<uint8_t> __receive_buffer;
+            // Frames sent and received over the whole run, `drain` waits until they match on all ranks.
+            uint64_t __sent;
+            uint64_t __received;
+
+          public:
+            Node(const Placement& placement, uint64_t rank);
+            Node(const Node&) = delete;
+            auto operator=(const Node&) -> Node& = delete;
+            ~Node();
+
+            [[nodiscard]] auto placement() const -> const Placement& { return __placement; }
+            [[nodiscard]] auto rank() const -> uint64_t { return __rank; }
+            [[nodiscard]] auto first() const -> uint64_t { return __placement.first(__rank); }
+            [[nodiscard]] auto network() -> LocalTransport::Network& { return __network; }
+            // Safe to call from any thread.
+            auto post(Envelope envelope) -> void { __outbox.push(std::move(envelope)); }
+
+            // Communication loop, runs on the thread that initialized MPI until `running` drops to zero.
+            auto serve(const std::atomic<uint64_t>& running) -> void;
+            // Receives everything in flight once hosted actors stopped, frames for them are dropped in their mailboxes.
+            // Collective over MPI_COMM_WORLD, communication thread only.
+            auto drain() -> void;
+
+          private:
+            // Returns whether anything was sent or received.
+            auto flush() -> bool;
+            auto poll() -> bool;
+            auto reclaim_sends() -> void;
+        };
+
+      private:
+        // Receivers of a fan-out split by the rank hosting them.
+        struct Routes : public Fanout::State {
+            std::vector<uint64_t> local;
+            std::vector<std::vector<uint64_t>> remote;
+        };
+
+        Node& __node;
+
+      public:
+        HybridTransport(Node& node, uint64_t id)
+          : LocalTransport(node.network(), id - node.first()),
+            __node(node) {}
+
+        auto send(const Message& message, uint64_t receiver) -> void override;
+        auto send(const Message& message, Fanout& fanout) -> void override;
+    };
+}
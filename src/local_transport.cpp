@@ -0,0 +1,55 @@
+#include "local_transport.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace nouveaux {
+
+    namespace {
+        // Inverse of `LocalTransport::now`.
+        auto time_point_of(double seconds) -> std::chrono::steady_clock::time_point {
+            return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds)));
+        }
+    }
+
+    auto LocalTransport::send(const Message& message, uint64_t receiver) -> void {
+        __network.mailbox(receiver).push(message);
+    }
+
+    auto LocalTransport::send(const Message& message, Fanout& fanout) -> void {
+        for (auto&& receiver : fanout.receivers()) {
+            __network.mailbox(receiver).push(message);
+        }
+    }
+
+    auto LocalTransport::receive(int source) -> Message {
+        auto deferred = std::find_if(__deferred.begin(), __deferred.end(), [&](auto&& message) {
+            return source == ANY_SOURCE || message.sender == static_cast<uint64_t>(source);
+        });
+        if (deferred != __deferred.end()) {
+            auto message = *deferred;
+            __deferred.erase(deferred);
+            return message;
+        }
+
+        while (true) {
+            Message message;
+            if (std::isinf(__wake_at)) {
+                message = __mailbox.pop();
+            } else if (!__mailbox.pop_until(message, time_point_of(__wake_at))) {
+                // Nothing came until the wake-up was due, it's delivered just once.
+                __wake_at = std::numeric_limits<double>::infinity();
+                return Message {};
+            }
+            if (source == ANY_SOURCE || message.sender == static_cast<uint64_t>(source)) {
+                return message;
+            }
+            __deferred.push_back(message);
+        }
+    }
+
+    auto LocalTransport::now() const -> double {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
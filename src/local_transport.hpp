@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+
+#include "mailbox.hpp"
+#include "transport.hpp"
+
+namespace nouveaux {
+
+    // In-process transport, every actor runs on its own thread and owns a lock-free mailbox.
+    //
+    // Used to run configurations far larger than the number of MPI ranks one machine can oversubscribe,
+    // and to profile the protocol without MPI overhead.
+    class LocalTransport : public Transport {
+      public:
+        // Mailboxes of every actor in the process, indexed by actor id (rank).
+        class Network {
+            std::unique_ptr<Mailbox[]> __mailboxes;
+            uint64_t __size;
+
+          public:
+            explicit Network(uint64_t size)
+              : __mailboxes(new Mailbox[size]),
+                __size(size) {}
+
+            [[nodiscard]] auto mailbox(uint64_t id) -> Mailbox& { return __mailboxes[id]; }
+            [[nodiscard]] auto size() const -> uint64_t { return __size; }
+        };
+
+      private:
+        Network& __network;
+        Mailbox& __mailbox;
+        // Messages taken out of mailbox while waiting for specific sender.
+        std::deque<Message> __deferred;
+        // Time of the pending wake-up, infinity when there is none.
+        double __wake_at;
+
+      public:
+        LocalTransport(Network& network, uint64_t id)
+          : __network(network),
+            __mailbox(network.mailbox(id)),
+            __deferred({}),
+            __wake_at(std::numeric_limits<double>::infinity()) {}
+
+        auto send(const Message& message, uint64_t receiver) -> void override;
+        auto send(const Message& message, Fanout& fanout) -> void override;
+        [[nodiscard]] auto receive(int source) -> Message override;
+        [[nodiscard]] auto now() const -> double override;
+        auto wake_at(double time) -> void override { __wake_at = time; }
+    };
+}
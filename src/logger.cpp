@@ -25,8 +25,8 @@ namespace nouveaux {
 #endif
     }
 
-    auto Logger::get() -> std::shared_ptr<spdlog::logger> {
-        return __logger;
+    auto Logger::get() -> spdlog::logger& {
+        return *__logger;
     }
 
 }
\ No newline at end of file
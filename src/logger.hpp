@@ -12,14 +12,35 @@
 
 #pragma GCC diagnostic pop
 
+#include "recorder.hpp"
+
+// Log calls below this level (spdlog numbering, 0 is trace) are compiled out.
+#if !defined(NOUVEAUX_LOG_LEVEL)
+    #if defined(NOUVEAUX_DEBUG)
+        #define NOUVEAUX_LOG_LEVEL SPDLOG_LEVEL_TRACE
+    #else
+        #define NOUVEAUX_LOG_LEVEL SPDLOG_LEVEL_INFO
+    #endif
+#endif
+
 namespace nouveaux {
     class Logger {
         static std::shared_ptr<spdlog::logger> __logger;
 
       public:
         static auto init(uint64_t id) -> void;
-        [[nodiscard]] static auto get() -> std::shared_ptr<spdlog::logger>;
+        // Reference, not a copy of the shared pointer, so that log calls don't touch its reference count.
+        [[nodiscard]] static auto get() -> spdlog::logger&;
     };
+
+    namespace logging {
+        template<int LEVEL, typename... T>
+        inline void record(const char* fmt, const T&... args) {
+            if (auto recorder = FlightRecorder::current()) {
+                recorder->record(LEVEL, fmt, args...);
+            }
+        }
+    }
 }
 
 #if defined(NOUVEAUX_DISABLE_LOGS)
@@ -30,29 +51,48 @@ namespace nouveaux {
     #define error(fmt, ...)
     #define critical(fmt, ...)
 #else
+// Trace and debug calls are compiled out below NOUVEAUX_LOG_LEVEL, so release builds pay for neither sink.
 template<typename S, typename... T>
 constexpr void trace(S fmt, T&&... args) {
-    nouveaux::Logger::get()->trace(fmt, std::forward<T>(args)...);
+    if constexpr (SPDLOG_LEVEL_TRACE >= NOUVEAUX_LOG_LEVEL) {
+        nouveaux::logging::record<SPDLOG_LEVEL_TRACE>(fmt, args...);
+        nouveaux::Logger::get().trace(fmt, std::forward<T>(args)...);
+    }
 }
 template<typename S, typename... T>
 constexpr void debug(S fmt, T&&... args) {
-    nouveaux::Logger::get()->debug(fmt, std::forward<T>(args)...);
+    if constexpr (SPDLOG_LEVEL_DEBUG >= NOUVEAUX_LOG_LEVEL) {
+        nouveaux::logging::record<SPDLOG_LEVEL_DEBUG>(fmt, args...);
+        nouveaux::Logger::get().debug(fmt, std::forward<T>(args)...);
+    }
 }
 template<typename S, typename... T>
 constexpr void info(S fmt, T&&... args) {
-    nouveaux::Logger::get()->info(fmt, std::forward<T>(args)...);
+    if constexpr (SPDLOG_LEVEL_INFO >= NOUVEAUX_LOG_LEVEL) {
+        nouveaux::logging::record<SPDLOG_LEVEL_INFO>(fmt, args...);
+        nouveaux::Logger::get().info(fmt, std::forward<T>(args)...);
+    }
 }
 template<typename S, typename... T>
 constexpr void warn(S fmt, T&&... args) {
-    nouveaux::Logger::get()->warn(fmt, std::forward<T>(args)...);
+    if constexpr (SPDLOG_LEVEL_WARN >= NOUVEAUX_LOG_LEVEL) {
+        nouveaux::logging::record<SPDLOG_LEVEL_WARN>(fmt, args...);
+        nouveaux::Logger::get().warn(fmt, std::forward<T>(args)...);
+    }
 }
 template<typename S, typename... T>
 constexpr void error(S fmt, T&&... args) {
-    nouveaux::Logger::get()->error(fmt, std::forward<T>(args)...);
+    if constexpr (SPDLOG_LEVEL_ERROR >= NOUVEAUX_LOG_LEVEL) {
+        nouveaux::logging::record<SPDLOG_LEVEL_ERROR>(fmt, args...);
+        nouveaux::Logger::get().error(fmt, std::forward<T>(args)...);
+    }
 }
 template<typename S, typename... T>
 constexpr void critical(S fmt, T&&... args) {
-    nouveaux::Logger::get()->critical(fmt, std::forward<T>(args)...);
+    if constexpr (SPDLOG_LEVEL_CRITICAL >= NOUVEAUX_LOG_LEVEL) {
+        nouveaux::logging::record<SPDLOG_LEVEL_CRITICAL>(fmt, args...);
+        nouveaux::Logger::get().critical(fmt, std::forward<T>(args)...);
+    }
 }
 // #else
 //     #define trace(fmt, ...) nouveaux::Logger::get()->trace(fmt, __VA_ARGS__);
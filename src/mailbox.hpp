@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "message.hpp"
+
+namespace nouveaux {
+
+    // Lock-free multiple producer, single consumer queue (Vyukov's MPSC queue).
+    //
+    // Producers only exchange the head pointer, consumer owns the tail. Consumer that finds
+    // the queue empty for a while parks on a condition variable, producers take the mutex
+    // only when consumer announced it's parked. Replies usually come within microseconds, so consumer
+    // yields for `PATIENCE` before parking, otherwise nearly every message paid for a park and a wake-up.
+    template<typename Item>
+    class BasicMailbox {
+        struct Node {
+            std::atomic<Node*> next;
+            Item message;
+        };
+
+        alignas(64) std::atomic<Node*> __head;
+        alignas(64) Node* __tail;
+        std::atomic<bool> __parked;
+        std::mutex __mutex;
+        std::condition_variable __wakeup;
+
+        // How long an empty consumer keeps yielding before it parks.
+        static constexpr auto PATIENCE = std::chrono::microseconds(50);
+
+      public:
+        BasicMailbox()
+          : __head(new Node { { nullptr }, {} }),
+            __tail(__head.load()),
+            __parked(false) {}
+
+        BasicMailbox(const BasicMailbox&) = delete;
+        auto operator=(const BasicMailbox&) -> BasicMailbox& = delete;
+
+        ~BasicMailbox() {
+            while (__tail != nullptr) {
+                auto next = __tail->next.load();
+                delete __tail;
+                __tail = next;
+            }
+        }
+
+        // Safe to call from any thread.
+        auto push(Item message) -> void {
+            auto node = new Node { { nullptr }, std::move(message) };
+            auto previous = __head.exchange(node, std::memory_order_acq_rel);
+            previous->next.store(node, std::memory_order_release);
+
+            // Pairs with the fence in `pop`, either consumer sees the node or we see it parked.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (__parked.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(__mutex);
+                __wakeup.notify_one();
+            }
+        }
+
+        // Consumer only. Returns false if there is nothing to take right now.
+        auto try_pop(Item& message) -> bool {
+            auto tail = __tail;
+            auto next = tail->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                return false;
+            }
+
+            message = std::move(next->message);
+            __tail = next;
+            delete tail;
+            return true;
+        }
+
+        // Consumer only. Blocks until message arrives.
+        auto pop() -> Item {
+            Item message;
+            // Without deadline it never gives up.
+            pop_until(message, std::chrono::steady_clock::time_point::max());
+            return message;
+        }
+
+        // Consumer only. Blocks until message arrives or `deadline` passes, returns false in the latter case.
+        auto pop_until(Item& message, std::chrono::steady_clock::time_point deadline) -> bool {
+            for (int spin = 0; spin < 64; ++spin) {
+                if (try_pop(message)) {
+                    return true;
+                }
+            }
+            // Yielding lets the producer run even when it shares the core.
+            const auto patience = std::min(deadline, std::chrono::steady_clock::now() + PATIENCE);
+            while (std::chrono::steady_clock::now() < patience) {
+                std::this_thread::yield();
+                if (try_pop(message)) {
+                    return true;
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(__mutex);
+            while (true) {
+                __parked.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (try_pop(message)) {
+                    __parked.store(false, std::memory_order_relaxed);
+                    return true;
+                }
+                auto expired = false;
+                if (deadline == std::chrono::steady_clock::time_point::max()) {
+                    __wakeup.wait(lock);
+                } else {
+                    expired = __wakeup.wait_until(lock, deadline) == std::cv_status::timeout;
+                }
+                __parked.store(false, std::memory_order_relaxed);
+                if (try_pop(message)) {
+                    return true;
+                }
+                if (expired) {
+                    return false;
+                }
+            }
+        }
+    };
+
+    using Mailbox = BasicMailbox<Message>;
+}
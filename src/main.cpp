@@ -1,21 +1,80 @@
 #include <mpi.h>
 
 #include "config.hpp"
+#include "hybrid_transport.hpp"
 #include "logger.hpp"
-#include "student.hpp"
-#include "winemaker.hpp"
+#include "mpi_transport.hpp"
+#include "runner.hpp"
+#include "stock_table.hpp"
 
 using namespace nouveaux;
 
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    const auto config = Config::parse("config.toml");
+    if (!validate(config)) {
+        fmt::print(stderr, "Invalid configuration. Aborting.\n");
+        return -1;
+    }
+    FlightRecorder::install_signal_handlers();
+    if (config.transport == "local") {
+        const auto report = run_local(config);
+        conclude(config, 1, report.winemakers, report.students, report.duration);
+        return 0;
+    }
+    if (config.transport == "simulation") {
+        const auto report = run_simulation(config);
+        // Bounded run may be over before simulation time runs out.
+        const auto duration = report.duration;
+        fmt::print("simulated {:.3f} s, seed {}, {} messages delivered\n", duration, config.seed, report.delivered);
+        // Winemakers' hold lasts from stocking the safehouse until it's reported empty.
+        const auto stocked = report.winemakers.hold.sum * 1e-9 / (config.safehouse_count * duration);
+        const auto idle = report.winemakers.idle.sum * 1e-9 / (config.winemaker_count * duration);
+        fmt::print("safehouse utilization {:.1f}%, winemaker idle {:.1f}%\n", stocked * 100, idle * 100);
+        report.winemakers.print("winemakers", duration);
+        report.students.print("students", duration);
+        conclude(config, 1, report.winemakers, report.students, duration);
+        return 0;
+    }
+
+    if (config.transport == "hybrid" || config.progress_thread) {
+        // Only the main (communication or progress) thread calls MPI.
+        int provided;
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+        if (provided < MPI_THREAD_FUNNELED) {
+            fmt::print(stderr, "MPI library doesn't support calls from main thread of multithreaded process (MPI_THREAD_FUNNELED), required by {}. Aborting.\n", config.progress_thread ? "progress thread" : "hybrid transport");
+            return -1;
+        }
+    } else {
+        MPI_Init(&argc, &argv);
+    }
 
     uint32_t rank;
     uint32_t size;
     MPI_Comm_rank(MPI_COMM_WORLD, reinterpret_cast<int*>(&rank));
     MPI_Comm_size(MPI_COMM_WORLD, reinterpret_cast<int*>(&size));
 
-    const auto config = Config::parse("config.toml");
+    if (config.transport == "hybrid") {
+        const HybridTransport::Placement placement(config.winemaker_count + config.student_count, size, config.actors_per_rank);
+        if (size < placement.ranks()) {
+            fmt::print(stderr, "At least {} processes are required for program to work correctly with current configuration. Aborting.\n", placement.ranks());
+            return -1;
+        }
+
+        Logger::init(rank);
+        const auto report = run_hybrid(config, rank, size);
+        const auto winemakers = report.winemakers.reduce(0);
+        const auto students = report.students.reduce(0);
+        if (rank == 0) {
+            auto summary = winemakers;
+            summary.merge(students);
+            summary.print("all ranks", report.duration);
+            conclude(config, size, winemakers, students, report.duration);
+        }
+
+        MPI_Finalize();
+        return 0;
+    }
+
     if (size < (config.winemaker_count + config.student_count)) {
         fmt::print(stderr, "At least {} processes are required for program to work correctly with current configuration. Aborting.\n", (config.winemaker_count + config.student_count));
         return -1;
@@ -23,21 +82,42 @@ int main(int argc, char** argv) {
 
     Logger::init(rank);
 
-    if (static_cast<uint64_t>(rank) < config.winemaker_count) {
-        trace("Spawning winemaker #{}.", rank);
-        auto winemaker = Winemaker(config.safehouse_count, rank, config.winemaker_count, config.student_count, 0, config.winemaker_count, config.min_wine_volume, config.max_wine_volume);
+    {
+        MpiTransport transport(config.receive_slots);
+        Metrics metrics {};
+        auto events = open_event_log(config, rank);
+        auto recorder = open_flight_recorder(config, rank);
+        const auto start = transport.now();
+        Transport::bind(transport);
+        Metrics::bind(metrics);
+        EventLog::bind(events.get());
+        FlightRecorder::bind(recorder.get());
+        // `validate` rejected stock table with progress thread, which would make RMA calls from the actor thread.
+        std::unique_ptr<StockTable> table;
+        if (config.stock_table) {
+            table = std::make_unique<StockTable>(config.safehouse_count);
+        }
+        StockTable::bind(table.get());
+        if (config.progress_thread) {
+            spawn_with_progress(config, rank, transport);
+        } else {
+            spawn(config, rank);
+        }
+        // Bounded run is over, nothing may be left in flight once MPI is finalized.
+        [[maybe_unused]] const auto dropped = transport.drain();
+        trace("Drained {} messages still in flight.", dropped);
+        const auto duration = transport.now() - start;
 
+        const Metrics none {};
+        const auto winemaker = static_cast<uint64_t>(rank) < config.winemaker_count;
+        const auto winemakers = (winemaker ? metrics : none).reduce(0);
+        const auto students = (winemaker ? none : metrics).reduce(0);
         if (rank == 0) {
-            trace("Safehouse count: {}", config.safehouse_count);
-            trace("Winemakers count: {}", winemaker.__winemakers_count);
-            trace("Students count: {}", winemaker.__students_count);
+            auto summary = winemakers;
+            summary.merge(students);
+            summary.print("all ranks", duration);
+            conclude(config, size, winemakers, students, duration);
         }
-
-        winemaker.run();
-    } else {
-        trace("Spawning student #{}.", rank);
-        auto student = Student(config.safehouse_count, rank, config.winemaker_count, config.student_count, 0, config.winemaker_count, config.min_wine_volume, config.max_wine_volume);
-        student.run();
     }
 
     MPI_Finalize();
@@ -0,0 +1,117 @@
+#include "manager_exclusion.hpp"
+
+#include "logger.hpp"
+#include "metrics.hpp"
+
+#define format(fmt) "[{:0>10}] MANAGER #{} " fmt, __clock.load(std::memory_order_relaxed), __rank
+
+namespace nouveaux {
+
+    ManagerExclusion::ManagerExclusion(std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t students_start_id, uint64_t winemakers_start_id, uint64_t winemakers_count)
+      : Exclusion(clock, rank),
+        __locks(safehouse_count, Lock { NONE, {}, 0 }),
+        __students_start_id(students_start_id),
+        __winemakers_start_id(winemakers_start_id),
+        __winemakers_count(winemakers_count),
+        __safehouse(NONE),
+        __granted(false),
+        __stock(0) {}
+
+    auto ManagerExclusion::manager_of(uint64_t safehouse, uint64_t students_start_id, uint64_t winemakers_start_id, uint64_t winemakers_count) -> uint64_t {
+        // Same winemaker initially holding the token in token protocol.
+        if (winemakers_count == 0) {
+            return students_start_id;
+        }
+        return winemakers_start_id + safehouse % winemakers_count;
+    }
+
+    auto ManagerExclusion::acquire(uint64_t safehouse, const Observer& observer) -> bool {
+        __safehouse = safehouse;
+        __granted = false;
+        const auto manager = manager_of(safehouse, __students_start_id, __winemakers_start_id, __winemakers_count);
+        send_lock(Message::Type::LOCK_REQUEST, safehouse, 0, manager);
+
+        while (!__granted) {
+            auto message = receive();
+            handle(message);
+            observer(message);
+        }
+
+        trace(format("HOLDS LOCK #{} {{ stock: {} }}"), safehouse, __stock);
+        return true;
+    }
+
+    auto ManagerExclusion::release() -> void {
+        const auto manager = manager_of(__safehouse, __students_start_id, __winemakers_start_id, __winemakers_count);
+        send_lock(Message::Type::LOCK_RELEASE, __safehouse, __stock, manager);
+        __safehouse = NONE;
+        __granted = false;
+    }
+
+    auto ManagerExclusion::stock() -> uint64_t* {
+        if (__safehouse == NONE || !__granted) {
+            return nullptr;
+        }
+        return &__stock;
+    }
+
+    auto ManagerExclusion::handle(const Message& message) -> void {
+        const auto safehouse = message.payload.safehouse_index;
+        switch (message.type) {
+            case Message::Type::LOCK_REQUEST:
+                debug(format("received LOCK REQUEST {{ timestamp: {}, sender: {}, safehouse: {} }}"), message.timestamp, message.sender, safehouse);
+                __locks[safehouse].waiting.push_back(message.sender);
+                grant(safehouse);
+                break;
+            case Message::Type::LOCK_RELEASE:
+                debug(format("received LOCK RELEASE {{ timestamp: {}, sender: {}, safehouse: {}, stock: {} }}"), message.timestamp, message.sender, safehouse, message.payload.wine_volume);
+                __locks[safehouse].holder = NONE;
+                __locks[safehouse].stock = message.payload.wine_volume;
+                grant(safehouse);
+                break;
+            case Message::Type::LOCK_GRANT:
+                debug(format("received LOCK GRANT {{ timestamp: {}, sender: {}, safehouse: {}, stock: {} }}"), message.timestamp, message.sender, safehouse, message.payload.wine_volume);
+                if (safehouse == __safehouse) {
+                    __granted = true;
+                    __stock = message.payload.wine_volume;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    auto ManagerExclusion::grant(uint64_t safehouse) -> void {
+        auto& lock = __locks[safehouse];
+        if (lock.holder != NONE || lock.waiting.empty()) {
+            return;
+        }
+        lock.holder = lock.waiting.front();
+        lock.waiting.pop_front();
+        if (lock.holder == __rank) {
+            ++Metrics::current().reuses;
+        }
+        send_lock(Message::Type::LOCK_GRANT, safehouse, lock.stock, lock.holder);
+    }
+
+    auto ManagerExclusion::send_lock(Message::Type type, uint64_t safehouse, uint64_t stock, uint64_t receiver) -> void {
+        ++__clock;
+        Message message {
+            /* .type = */ type,
+            /* .sender = */ __rank,
+            /* .timestamp = */ __clock,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ safehouse,
+              /* .wine_volume = */ stock,
+              /* .last_timestamp = */ 0,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            },
+        };
+
+        // Manager acquiring safehouse it manages goes through the loopback, without any message.
+        send(message, receiver);
+    }
+}
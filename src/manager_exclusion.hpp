@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "exclusion.hpp"
+
+namespace nouveaux {
+
+    // Lock manager protocol shared by winemakers and students: every safehouse has a manager granting it.
+    //
+    // Managers are the winemakers already bound to safehouses (safehouse `s` is managed by winemaker
+    // `s mod W`), they keep the stock and grant the lock to requesters in arrival order. Acquisition
+    // costs LOCK_REQUEST, LOCK_GRANT carrying the stock and LOCK_RELEASE bringing it back, no matter
+    // the number of actors, and no message at all when manager acquires safehouse it manages.
+    class ManagerExclusion : public Exclusion {
+#if defined(NOUVEAUX_DEBUG)
+      public:
+#endif
+        struct Lock {
+            // Process holding the lock, NONE when it's free.
+            uint64_t holder;
+            // Requesters waiting for the lock, in arrival order.
+            std::deque<uint64_t> waiting;
+            // Wine in safehouse, valid only while the lock is free.
+            uint64_t stock;
+        };
+        // Per safehouse lock state, used only for safehouses this process manages.
+        //
+        // MUTABILITY: Should change only when received LOCK_REQUEST or LOCK_RELEASE.
+        std::vector<Lock> __locks;
+        const uint64_t __students_start_id;
+        const uint64_t __winemakers_start_id;
+        const uint64_t __winemakers_count;
+        // Safehouse currently acquired or held, NONE when there is none.
+        //
+        // MUTABILITY: Should change only when safehouse is acquired or released.
+        uint64_t __safehouse;
+        // Whether manager granted `__safehouse`.
+        //
+        // MUTABILITY: Should change only when safehouse is acquired or released, or received LOCK_GRANT.
+        bool __granted;
+        // Wine in held safehouse, valid only while granted.
+        uint64_t __stock;
+
+      public:
+        static constexpr uint64_t NONE = UINT64_MAX;
+
+        ManagerExclusion(std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t students_start_id, uint64_t winemakers_start_id, uint64_t winemakers_count);
+
+        auto handle(const Message& message) -> void override;
+        // Request can't be withdrawn once sent, observer can't abandon acquisition.
+        [[nodiscard]] auto acquire(uint64_t safehouse, const Observer& observer) -> bool override;
+        auto release() -> void override;
+        [[nodiscard]] auto stock() -> uint64_t* override;
+
+        // Process granting `safehouse`.
+        [[nodiscard]] static auto manager_of(uint64_t safehouse, uint64_t students_start_id, uint64_t winemakers_start_id, uint64_t winemakers_count) -> uint64_t;
+
+      private:
+        // Passes free lock of managed `safehouse` to the first requester waiting for it.
+        auto grant(uint64_t safehouse) -> void;
+        auto send_lock(Message::Type type, uint64_t safehouse, uint64_t stock, uint64_t receiver) -> void;
+    };
+}
@@ -0,0 +1,48 @@
+#include "message.hpp"
+
+#include "event_log.hpp"
+#include "metrics.hpp"
+
+namespace nouveaux {
+
+    auto Message::send_to(uint64_t receiver) const -> void {
+        ++Metrics::current().sent[static_cast<size_t>(codec::layout(type).type)];
+        if (auto log = EventLog::current()) {
+            log->sent(*this, receiver, 1);
+        }
+        Transport::current().send(*this, receiver);
+    }
+
+    auto Message::send_to(Transport::Fanout& fanout) const -> void {
+        Metrics::current().sent[static_cast<size_t>(codec::layout(type).type)] += fanout.receivers().size();
+        auto log = EventLog::current();
+        if (log != nullptr && !fanout.receivers().empty()) {
+            log->sent(*this, EventLog::FANOUT, fanout.receivers().size());
+        }
+        Transport::current().send(*this, fanout);
+    }
+
+    auto Message::receive_from(int sender) -> Message {
+        auto message = Transport::current().receive(sender);
+        // Transport's wake-ups come from nobody, they're neither counted nor logged.
+        if (message.type != Type::UNKNOWN) {
+            message.received();
+        }
+        return message;
+    }
+
+    auto Message::poll(Message& message) -> bool {
+        if (!Transport::current().try_receive(message)) {
+            return false;
+        }
+        message.received();
+        return true;
+    }
+
+    auto Message::received() const -> void {
+        ++Metrics::current().received[static_cast<size_t>(codec::layout(type).type)];
+        if (auto log = EventLog::current()) {
+            log->received(*this);
+        }
+    }
+}
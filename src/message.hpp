@@ -1,14 +1,13 @@
 #pragma once
 
 #include <cstdint>
-#include <cstring>
-#include <mpi.h>
 
-#include "tags.hpp"
+#include "transport.hpp"
 
 namespace nouveaux {
 
-    constexpr auto ANY_SOURCE = MPI_ANY_SOURCE;
+    // Wildcard sender for `Message::receive_from`.
+    constexpr int ANY_SOURCE = -1;
 
     struct Message {
         enum struct Type : uint64_t {
@@ -18,13 +17,40 @@ namespace nouveaux {
             WINEMAKER_BROADCAST,
             STUDENT_REQUEST,
             STUDENT_ACKNOWLEDGE,
-            STUDENT_BROADCAST
+            STUDENT_BROADCAST,
+            STUDENT_RELEASE,
+            STUDENT_INQUIRE,
+            STUDENT_RELINQUISH,
+            STUDENT_FAILED,
+            TOKEN_REQUEST,
+            TOKEN,
+            // STUDENT_RELEASE of `released_index` piggybacked on STUDENT_REQUEST.
+            STUDENT_RELEASE_REQUEST,
+            // Actor met the bound of a bounded run, sent once to the coordinator.
+            DONE,
+            // Coordinator tells every actor to stop.
+            FINISH,
+            LOCK_REQUEST,
+            LOCK_GRANT,
+            LOCK_RELEASE,
+            // WINEMAKER_ACKNOWLEDGE of `released_index` piggybacked on WINEMAKER_REQUEST.
+            WINEMAKER_ACKNOWLEDGE_REQUEST
         };
 
         struct Payload {
             uint64_t safehouse_index;
             uint64_t wine_volume;
             uint64_t last_timestamp;
+            // Rank the message travels on behalf of, differs from sender only for forwarded messages (eg. TOKEN_REQUEST or broadcasts).
+            uint64_t origin;
+            // Safehouse released by message carrying another one (STUDENT_RELEASE_REQUEST).
+            uint64_t released_index;
+            // Lamport time `wine_volume` was reported at by whoever held the safehouse (STUDENT_ACKNOWLEDGE),
+            // zero when there is no such report. Requester's own freshest one on STUDENT_REQUEST.
+            uint64_t stocked_at;
+            // REQs of the same batch still to follow (STUDENT_REQUEST), further safehouses the reply
+            // stands for as bit mask, bit `i` meaning safehouse `safehouse_index + 1 + i` (STUDENT_ACKNOWLEDGE, STUDENT_FAILED).
+            uint64_t batch;
         };
 
         Type type;
@@ -36,86 +62,13 @@ namespace nouveaux {
         // appropriate fields in this struct will be filled.
         Payload payload;
 
-        auto send_to(uint64_t receiver) -> void {
-            uint64_t message[4] = { timestamp, payload.safehouse_index, payload.wine_volume, payload.last_timestamp };
-            uint64_t tag = 0;
-            uint64_t size = 0;
-
-            switch (type) {
-                case Type::WINEMAKER_REQUEST:
-                    tag = WINEMAKER_ACQUIRE_REQ;
-                    size = 2;
-                    break;
-                case Type::WINEMAKER_ACKNOWLEDGE:
-                    tag = WINEMAKER_ACQUIRE_ACK;
-                    size = 1;
-                    break;
-                case Type::WINEMAKER_BROADCAST:
-                    tag = WINEMAKER_BROADCAST;
-                    size = 3;
-                    break;
-                case Type::STUDENT_REQUEST:
-                    tag = STUDENT_ACQUIRE_REQ;
-                    size = 3;
-                    break;
-                case Type::STUDENT_ACKNOWLEDGE:
-                    tag = STUDENT_ACQUIRE_ACK;
-                    size = 4;
-                    break;
-                case Type::STUDENT_BROADCAST:
-                    tag = STUDENT_BROADCAST;
-                    size = 2;
-                    break;
-                default:
-                    tag = UNKNOWN;
-                    break;
-            }
-
-            if (tag != UNKNOWN)
-                MPI_Send(&message, size, MPI_LONG_LONG, receiver, tag, MPI_COMM_WORLD);
-        }
-
-        static auto receive_from(uint64_t sender) -> Message {
-            uint64_t message[4] = { 0 };
-            MPI_Status status;
-            MPI_Recv(&message, 4, MPI_LONG_LONG, sender, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-
-            Type type;
-            switch (status.MPI_TAG) {
-                case WINEMAKER_ACQUIRE_REQ:
-                    type = Type::WINEMAKER_REQUEST;
-                    break;
-                case WINEMAKER_ACQUIRE_ACK:
-                    type = Type::WINEMAKER_ACKNOWLEDGE;
-                    break;
-                case WINEMAKER_BROADCAST:
-                    type = Type::WINEMAKER_BROADCAST;
-                    break;
-                case STUDENT_ACQUIRE_REQ:
-                    type = Type::STUDENT_REQUEST;
-                    break;
-                case STUDENT_ACQUIRE_ACK:
-                    type = Type::STUDENT_ACKNOWLEDGE;
-                    break;
-                case STUDENT_BROADCAST:
-                    type = Type::STUDENT_BROADCAST;
-                    break;
-                default:
-                    type = Type::UNKNOWN;
-                    break;
-            }
-
-            uint64_t message_sender = status.MPI_SOURCE;
-            uint64_t timestamp = message[0];
-            Payload payload {};
-            memcpy(&payload, &message[1], sizeof(uint64_t) * 3);
-
-            return Message {
-                type,
-                message_sender,
-                timestamp,
-                payload
-            };
-        }
+        auto send_to(uint64_t receiver) const -> void;
+        // Sends message to every receiver of the fan-out set at once.
+        auto send_to(Transport::Fanout& fanout) const -> void;
+        static auto receive_from(int sender) -> Message;
+        // Takes message already delivered without blocking, returns false if there is none.
+        static auto poll(Message& message) -> bool;
+        // Counts and logs message taken from the transport some other way, eg. by a responder answering it.
+        auto received() const -> void;
     };
 }
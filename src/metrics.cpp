@@ -0,0 +1,142 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#include <mpi.h>
+#include <spdlog/fmt/fmt.h>
+
+namespace nouveaux {
+
+    namespace {
+        thread_local Metrics* __current = nullptr;
+
+        auto print_histogram(const char* name, const Histogram& histogram, double scale) -> void {
+            fmt::print("  {:<18} {:>10} {:>12.3f} {:>12.3f} {:>12.3f} {:>12.3f}\n",
+                name,
+                histogram.count,
+                histogram.mean() * scale,
+                histogram.percentile(0.5) * scale,
+                histogram.percentile(0.99) * scale,
+                histogram.max * scale);
+        }
+    }
+
+    auto Histogram::merge(const Histogram& other) -> void {
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            buckets[bucket] += other.buckets[bucket];
+        }
+        count += other.count;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    auto Histogram::mean() const -> double {
+        return count > 0 ? static_cast<double>(sum) / count : 0.0;
+    }
+
+    auto Histogram::percentile(double quantile) const -> uint64_t {
+        const auto target = static_cast<uint64_t>(std::ceil(quantile * count));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            seen += buckets[bucket];
+            if (seen >= target && seen > 0) {
+                return std::min(lower_bound_of(bucket + 1) - 1, max);
+            }
+        }
+        return max;
+    }
+
+    auto Metrics::merge(const Metrics& other) -> void {
+        for (size_t type = 0; type < codec::TYPE_COUNT; ++type) {
+            sent[type] += other.sent[type];
+            received[type] += other.received[type];
+        }
+        wine_volume += other.wine_volume;
+        skips += other.skips;
+        reuses += other.reuses;
+        idle.merge(other.idle);
+        ack_wait.merge(other.ack_wait);
+        hold.merge(other.hold);
+        pending_acks.merge(other.pending_acks);
+        batch.merge(other.batch);
+    }
+
+    auto Metrics::messages() const -> uint64_t {
+        uint64_t total = 0;
+        for (size_t type = 1; type < codec::TYPE_COUNT; ++type) {
+            total += sent[type];
+        }
+        return total;
+    }
+
+    auto Metrics::reduce(int root) const -> Metrics {
+        // Everything but maxima is a sum, so the whole structure is reduced as an array of counters.
+        static_assert(std::is_trivially_copyable<Metrics>::value && sizeof(Metrics) % sizeof(uint64_t) == 0, "Metrics must be a plain array of counters");
+
+        Metrics total {};
+        MPI_Reduce(this, &total, sizeof(Metrics) / sizeof(uint64_t), MPI_UINT64_T, MPI_SUM, root, MPI_COMM_WORLD);
+
+        uint64_t maxima[] = { idle.max, ack_wait.max, hold.max, pending_acks.max, batch.max };
+        uint64_t reduced[] = { 0, 0, 0, 0, 0 };
+        MPI_Reduce(maxima, reduced, 5, MPI_UINT64_T, MPI_MAX, root, MPI_COMM_WORLD);
+        total.idle.max = reduced[0];
+        total.ack_wait.max = reduced[1];
+        total.hold.max = reduced[2];
+        total.pending_acks.max = reduced[3];
+        total.batch.max = reduced[4];
+
+        return total;
+    }
+
+    auto Metrics::print(const char* title, double duration) const -> void {
+        fmt::print("{}: {} units ({:.1f} units/s), {} acquisitions ({} reused), {} skips\n",
+            title,
+            wine_volume,
+            duration > 0.0 ? wine_volume / duration : 0.0,
+            ack_wait.count,
+            reuses,
+            skips);
+
+        fmt::print("  {:<18} {:>10} {:>12} {:>12} {:>12} {:>12}\n", "", "count", "mean", "p50", "p99", "max");
+        if (idle.count != 0) {
+            print_histogram("idle (ms)", idle, 1e-6);
+        }
+        print_histogram("ack wait (ms)", ack_wait, 1e-6);
+        print_histogram("hold (ms)", hold, 1e-6);
+        print_histogram("pending acks", pending_acks, 1.0);
+        if (batch.count != 0) {
+            print_histogram("batch size", batch, 1.0);
+        }
+
+        fmt::print("  {:<29} {:>12} {:>12}\n", "message", "sent", "received");
+        for (size_t type = 1; type < codec::TYPE_COUNT; ++type) {
+            if (sent[type] != 0 || received[type] != 0) {
+                fmt::print("  {:<29} {:>12} {:>12}\n", codec::LAYOUTS[type].name, sent[type], received[type]);
+            }
+        }
+    }
+
+    auto Metrics::summarize(const Metrics& winemakers, const Metrics& students, double duration) -> void {
+        const auto acquisitions = winemakers.ack_wait.count + students.ack_wait.count;
+        const auto messages = winemakers.messages() + students.messages();
+
+        fmt::print("total: {} units produced, {} consumed, {} acquisitions in {:.3f} s ({:.1f}/s), {} messages ({:.1f} per acquisition)\n",
+            winemakers.wine_volume,
+            students.wine_volume,
+            acquisitions,
+            duration,
+            duration > 0.0 ? acquisitions / duration : 0.0,
+            messages,
+            acquisitions > 0 ? static_cast<double>(messages) / acquisitions : 0.0);
+    }
+
+    auto Metrics::bind(Metrics& metrics) -> void {
+        __current = &metrics;
+    }
+
+    auto Metrics::current() -> Metrics& {
+        return *__current;
+    }
+}
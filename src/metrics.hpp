@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "codec.hpp"
+#include "message.hpp"
+
+namespace nouveaux {
+
+    // Log-bucketed histogram of non-negative integers (HDR style).
+    //
+    // Every power of two is split into `SUB_BUCKETS` linear buckets, so recorded values keep
+    // about 25% relative precision over the whole range at fixed size and constant recording cost.
+    struct Histogram {
+        static constexpr size_t SUB_BUCKETS = 4;
+        // Values of 2^MAX_EXPONENT and above share the last bucket.
+        static constexpr size_t MAX_EXPONENT = 48;
+        static constexpr size_t BUCKETS = (MAX_EXPONENT - 1) * SUB_BUCKETS;
+
+        uint64_t buckets[BUCKETS];
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+
+        auto record(uint64_t value) -> void {
+            ++buckets[bucket_of(value)];
+            ++count;
+            sum += value;
+            max = value > max ? value : max;
+        }
+
+        auto merge(const Histogram& other) -> void;
+        [[nodiscard]] auto mean() const -> double;
+        // Upper bound of the bucket holding `quantile` (0.0 - 1.0) of recorded values.
+        [[nodiscard]] auto percentile(double quantile) const -> uint64_t;
+
+        [[nodiscard]] static constexpr auto bucket_of(uint64_t value) -> size_t {
+            if (value < SUB_BUCKETS)
+                return value;
+            const size_t exponent = 63 - __builtin_clzll(value);
+            if (exponent >= MAX_EXPONENT)
+                return BUCKETS - 1;
+            return (exponent - 1) * SUB_BUCKETS + ((value >> (exponent - 2)) & (SUB_BUCKETS - 1));
+        }
+
+        [[nodiscard]] static constexpr auto lower_bound_of(size_t bucket) -> uint64_t {
+            if (bucket < SUB_BUCKETS)
+                return bucket;
+            return (SUB_BUCKETS + bucket % SUB_BUCKETS) << (bucket / SUB_BUCKETS - 1);
+        }
+    };
+
+    // Protocol metrics of single actor (or merged metrics of many).
+    //
+    // Like `Transport`, every thread running an actor binds its own instance with `bind`.
+    // Updates are plain increments of thread-owned memory, so metrics stay on in production builds.
+    // Times are recorded in nanoseconds of `Transport::now`.
+    struct Metrics {
+        // Messages by `Message::Type`, counted by transport-facing `Message` methods.
+        uint64_t sent[codec::TYPE_COUNT];
+        uint64_t received[codec::TYPE_COUNT];
+        // Wine units stored (winemaker) or consumed (student).
+        uint64_t wine_volume;
+        // Acquisitions given up because chosen safehouse turned out empty (students) or stocked (winemakers),
+        // while waiting or once acquired.
+        uint64_t skips;
+        // Acquisitions entered without any message: on permissions or token kept from earlier ones, or lock granted by itself.
+        uint64_t reuses;
+        // Time winemaker waited, since stocking previous safehouse, until one it could stock was empty, one sample per acquisition.
+        Histogram idle;
+        // Time from requesting safehouse (or its emptying, if requested earlier) to entering critical section,
+        // one sample per acquisition.
+        Histogram ack_wait;
+        // Time spent in critical section.
+        Histogram hold;
+        // Number of deferred REQs answered when winemaker leaves critical section.
+        Histogram pending_acks;
+        // Number of safehouses student requested together, one sample per request round.
+        Histogram batch;
+
+        auto merge(const Metrics& other) -> void;
+        // Messages sent, of every type.
+        [[nodiscard]] auto messages() const -> uint64_t;
+        // Sums metrics of all ranks on `root`, result is meaningful only there. Collective.
+        [[nodiscard]] auto reduce(int root) const -> Metrics;
+        // Human readable summary, `duration` (seconds) is used for throughput.
+        auto print(const char* title, double duration) const -> void;
+        // Totals of the whole run: wine produced and consumed, acquisitions per second and messages per acquisition.
+        static auto summarize(const Metrics& winemakers, const Metrics& students, double duration) -> void;
+
+        // Makes `metrics` the one updated by actor on calling thread.
+        static auto bind(Metrics& metrics) -> void;
+        [[nodiscard]] static auto current() -> Metrics&;
+    };
+
+    // Nanoseconds between two `Transport::now` readings.
+    [[nodiscard]] inline auto nanoseconds(double since, double until) -> uint64_t {
+        return until > since ? static_cast<uint64_t>((until - since) * 1e9) : 0;
+    }
+}
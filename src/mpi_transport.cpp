@@ -0,0 +1,246 @@
+#include "mpi_transport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nouveaux {
+
+    MpiTransport::MpiTransport(uint64_t slots)
+      : __slots(std::max<uint64_t>(slots, 1)),
+        __receives(__slots.size(), MPI_REQUEST_NULL),
+        __completed(__slots.size()),
+        __statuses(__slots.size()),
+        __posted({}),
+        __inbox({}),
+        __sent(0),
+        __received(0),
+        __wake_at(std::numeric_limits<double>::infinity()),
+        __send_buffers({}),
+        __sends({}),
+        __free_sends({}),
+        __reclaimed({}) {
+        for (uint64_t slot = 0; slot < __slots.size(); ++slot) {
+            post(slot);
+        }
+    }
+
+    MpiTransport::~MpiTransport() {
+        for (auto&& request : __receives) {
+            if (request != MPI_REQUEST_NULL) {
+                MPI_Cancel(&request);
+                MPI_Wait(&request, MPI_STATUS_IGNORE);
+            }
+        }
+        MPI_Waitall(__sends.size(), __sends.data(), MPI_STATUSES_IGNORE);
+    }
+
+    auto MpiTransport::send(const Message& message, uint64_t receiver) -> void {
+        const auto& layout = codec::layout(message.type);
+        if (layout.tag == UNKNOWN) {
+            return;
+        }
+
+        if (__free_sends.empty()) {
+            reclaim_sends();
+        }
+        if (__free_sends.empty()) {
+            __send_buffers.emplace_back();
+            __sends.push_back(MPI_REQUEST_NULL);
+            __free_sends.push_back(__sends.size() - 1);
+        }
+
+        auto index = __free_sends.back();
+        __free_sends.pop_back();
+        auto size = codec::encode(message, __send_buffers[index].data());
+        ++__sent;
+        MPI_Isend(__send_buffers[index].data(), size, MPI_BYTE, receiver, layout.tag, MPI_COMM_WORLD, &__sends[index]);
+    }
+
+    auto MpiTransport::send(const Message& message, Fanout& fanout) -> void {
+        const auto& layout = codec::layout(message.type);
+        if (layout.tag == UNKNOWN) {
+            return;
+        }
+
+        auto& state = fanout.state();
+        if (!state) {
+            state = std::make_unique<Persistent>(*this, fanout.receivers());
+        }
+
+        uint8_t buffer[FRAME_CAPACITY];
+        auto size = codec::encode(message, buffer);
+        __sent += fanout.receivers().size();
+        static_cast<Persistent&>(*state).start(buffer, size, layout.tag);
+    }
+
+    auto MpiTransport::receive(int source) -> Message {
+        while (true) {
+            auto frame = std::find_if(__inbox.begin(), __inbox.end(), [&](auto&& frame) {
+                return source == ANY_SOURCE || frame.source == static_cast<uint64_t>(source);
+            });
+            if (frame != __inbox.end()) {
+                auto message = codec::decode(frame->data, frame->size, frame->source);
+                __inbox.erase(frame);
+                return message;
+            }
+
+            if (std::isinf(__wake_at)) {
+                progress(true);
+                continue;
+            }
+            // Blocking wait would never notice the wake-up is due.
+            progress(false);
+            if (__inbox.empty() && now() >= __wake_at) {
+                __wake_at = std::numeric_limits<double>::infinity();
+                return Message {};
+            }
+        }
+    }
+
+    auto MpiTransport::try_receive(Message& message) -> bool {
+        if (__inbox.empty()) {
+            progress(false);
+        }
+        if (__inbox.empty()) {
+            return false;
+        }
+
+        const auto& frame = __inbox.front();
+        message = codec::decode(frame.data, frame.size, frame.source);
+        __inbox.pop_front();
+        return true;
+    }
+
+    auto MpiTransport::drain() -> uint64_t {
+        uint64_t dropped = 0;
+        uint64_t total[] = { 1, 0 };
+        // Nobody sends anymore, totals only grow closer. Once they match nothing is left in flight.
+        while (total[0] != total[1]) {
+            Message message;
+            while (try_receive(message)) {
+                ++dropped;
+            }
+            uint64_t counts[] = { __sent, __received };
+            MPI_Allreduce(counts, total, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        }
+        return dropped;
+    }
+
+    auto MpiTransport::now() const -> double {
+        return MPI_Wtime();
+    }
+
+    auto MpiTransport::progress(bool blocking) -> void {
+        int count = 0;
+        if (blocking) {
+            MPI_Waitsome(__receives.size(), __receives.data(), &count, __completed.data(), __statuses.data());
+        } else {
+            MPI_Testsome(__receives.size(), __receives.data(), &count, __completed.data(), __statuses.data());
+        }
+        if (count == MPI_UNDEFINED || count == 0) {
+            return;
+        }
+
+        __received += count;
+        for (int i = 0; i < count; ++i) {
+            auto& slot = __slots[__completed[i]];
+            slot.frame.tag = __statuses[i].MPI_TAG;
+            slot.frame.source = __statuses[i].MPI_SOURCE;
+            MPI_Get_count(&__statuses[i], MPI_BYTE, &slot.frame.size);
+            slot.complete = true;
+        }
+
+        // Keep per sender FIFO order the rest of the code relies on, stop at the first slot still pending.
+        while (__slots[__posted.front()].complete) {
+            auto slot = __posted.front();
+            __posted.pop_front();
+            __inbox.push_back(__slots[slot].frame);
+            post(slot);
+        }
+    }
+
+    auto MpiTransport::post(int slot) -> void {
+        __slots[slot].complete = false;
+        __posted.push_back(slot);
+        MPI_Irecv(__slots[slot].frame.data, FRAME_CAPACITY, MPI_BYTE, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &__receives[slot]);
+    }
+
+    auto MpiTransport::reclaim_sends() -> void {
+        __reclaimed.resize(__sends.size());
+
+        int count = 0;
+        MPI_Testsome(__sends.size(), __sends.data(), &count, __reclaimed.data(), MPI_STATUSES_IGNORE);
+        if (count == MPI_UNDEFINED) {
+            return;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            __free_sends.push_back(__reclaimed[i]);
+        }
+    }
+
+    MpiTransport::Persistent::Persistent(MpiTransport& transport, std::vector<uint64_t> receivers)
+      : __transport(transport),
+        __receivers(std::move(receivers)),
+        __requests(FRAME_CAPACITY + 1),
+        __buffer(FRAME_CAPACITY, 0),
+        __tag(-1),
+        __active(0) {}
+
+    MpiTransport::Persistent::~Persistent() {
+        release();
+    }
+
+    auto MpiTransport::Persistent::start(const uint8_t* data, int size, int tag) -> void {
+        // Previous round has to leave the buffer before it's overwritten.
+        wait();
+
+        if (tag != __tag) {
+            release();
+            __tag = tag;
+        }
+
+        auto& requests = __requests[size];
+        if (requests.empty() && !__receivers.empty()) {
+            requests.assign(__receivers.size(), MPI_REQUEST_NULL);
+            for (uint64_t i = 0; i < __receivers.size(); ++i) {
+                MPI_Send_init(__buffer.data(), size, MPI_BYTE, __receivers[i], tag, MPI_COMM_WORLD, &requests[i]);
+            }
+        }
+
+        memcpy(__buffer.data(), data, size);
+        if (!requests.empty()) {
+            MPI_Startall(requests.size(), requests.data());
+            __active = size;
+        }
+    }
+
+    auto MpiTransport::Persistent::wait() -> void {
+        if (__active == 0) {
+            return;
+        }
+
+        // Keep receiving while waiting, peers may be blocked on our receive slots.
+        auto& requests = __requests[__active];
+        int done = 0;
+        MPI_Testall(requests.size(), requests.data(), &done, MPI_STATUSES_IGNORE);
+        while (!done) {
+            __transport.progress(false);
+            MPI_Testall(requests.size(), requests.data(), &done, MPI_STATUSES_IGNORE);
+        }
+        __active = 0;
+    }
+
+    auto MpiTransport::Persistent::release() -> void {
+        wait();
+        for (auto&& requests : __requests) {
+            for (auto&& request : requests) {
+                if (request != MPI_REQUEST_NULL) {
+                    MPI_Request_free(&request);
+                }
+            }
+            requests.clear();
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include <mpi.h>
+
+#include "codec.hpp"
+#include "transport.hpp"
+
+namespace nouveaux {
+
+    // Nonblocking MPI transport, one actor per rank.
+    //
+    // Receives go through a fixed number of preposted `MPI_Irecv` slots. Every wakeup of `MPI_Waitsome`
+    // harvests all completed slots into the inbox at once, so following receives are served without any MPI call.
+    // Single sends use `MPI_Isend` from a pool of buffers, fixed fan-out sets use persistent requests.
+    class MpiTransport : public Transport {
+      public:
+        // Maximal encoded message length in bytes.
+        static constexpr int FRAME_CAPACITY = codec::MAX_SIZE;
+
+      private:
+        // Single message as it was received from the network.
+        struct Frame {
+            int tag;
+            uint64_t source;
+            int size;
+            uint8_t data[FRAME_CAPACITY];
+        };
+
+        struct Slot {
+            Frame frame;
+            // Receive finished, but the frame waits until every slot posted before it is delivered.
+            bool complete;
+        };
+
+        // Persistent send requests of a fan-out.
+        //
+        // Requests are created with `MPI_Send_init` the first time given message length is sent and reused
+        // by `MPI_Startall` afterwards. Encoded length varies only by a few bytes, so only a few request sets exist.
+        // Requests are recreated if message tag changes, so every fan-out should carry one message type.
+        class Persistent : public Fanout::State {
+            MpiTransport& __transport;
+            std::vector<uint64_t> __receivers;
+            // Persistent requests indexed by message length.
+            std::vector<std::vector<MPI_Request>> __requests;
+            std::vector<uint8_t> __buffer;
+            int __tag;
+            // Length of messages currently in flight, zero if none.
+            int __active;
+
+          public:
+            Persistent(MpiTransport& transport, std::vector<uint64_t> receivers);
+            ~Persistent() override;
+
+            auto start(const uint8_t* data, int size, int tag) -> void;
+
+          private:
+            auto wait() -> void;
+            auto release() -> void;
+        };
+
+        std::vector<Slot> __slots;
+        std::vector<MPI_Request> __receives;
+        std::vector<int> __completed;
+        std::vector<MPI_Status> __statuses;
+        // Slots in posting order. Frames are delivered from the front only, so a slot that completes early
+        // never overtakes one posted before it and per sender FIFO order holds.
+        std::deque<int> __posted;
+        std::deque<Frame> __inbox;
+        // Messages sent (to every receiver of a fan-out) and received over the whole run, `drain` waits until
+        // they match on all ranks.
+        uint64_t __sent;
+        uint64_t __received;
+        // Time of the pending wake-up, infinity when there is none.
+        double __wake_at;
+
+        // Send buffers must not move while `MPI_Isend` is in flight, hence deque.
+        std::deque<std::array<uint8_t, FRAME_CAPACITY>> __send_buffers;
+        std::vector<MPI_Request> __sends;
+        std::vector<int> __free_sends;
+        std::vector<int> __reclaimed;
+
+      public:
+        explicit MpiTransport(uint64_t slots);
+        MpiTransport(const MpiTransport&) = delete;
+        auto operator=(const MpiTransport&) -> MpiTransport& = delete;
+        ~MpiTransport() override;
+
+        auto send(const Message& message, uint64_t receiver) -> void override;
+        auto send(const Message& message, Fanout& fanout) -> void override;
+        [[nodiscard]] auto receive(int source) -> Message override;
+        [[nodiscard]] auto now() const -> double override;
+        [[nodiscard]] auto try_receive(Message& message) -> bool override;
+        auto wake_at(double time) -> void override { __wake_at = time; }
+        // Receives and drops everything in flight once actors stopped sending, collective over MPI_COMM_WORLD.
+        // Returns number of messages dropped by this rank.
+        auto drain() -> uint64_t;
+
+      private:
+        auto progress(bool blocking) -> void;
+        auto post(int slot) -> void;
+        auto reclaim_sends() -> void;
+    };
+}
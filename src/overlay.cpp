@@ -0,0 +1,75 @@
+#include "overlay.hpp"
+
+#include "logger.hpp"
+
+namespace nouveaux {
+
+    namespace {
+        thread_local Overlay* __current = nullptr;
+
+        // Broadcaster takes the root, outside of the group it comes first.
+        auto size_of(uint64_t origin, const Overlay::Group& group) -> uint64_t {
+            return group.contains(origin) ? group.count : group.count + 1;
+        }
+
+        auto position_of(uint64_t rank, uint64_t origin, const Overlay::Group& group) -> uint64_t {
+            if (rank == origin) {
+                return 0;
+            }
+            if (group.contains(origin)) {
+                return (rank + group.count - origin) % group.count;
+            }
+            return rank - group.start_id + 1;
+        }
+
+        auto rank_at(uint64_t position, uint64_t origin, const Overlay::Group& group) -> uint64_t {
+            if (group.contains(origin)) {
+                return group.start_id + (origin - group.start_id + position) % group.count;
+            }
+            return position == 0 ? origin : group.start_id + position - 1;
+        }
+    }
+
+    Overlay::Overlay(uint64_t arity, uint32_t rank, const Group& winemakers, const Group& students)
+      : __arity(arity),
+        __rank(rank),
+        __winemakers(winemakers),
+        __students(students) {}
+
+    auto Overlay::send(const Message& message, const Group& group) const -> void {
+        send_children(message, __rank, group, 0);
+    }
+
+    auto Overlay::forward(const Message& message) const -> void {
+        if (!concerns(message)) {
+            return;
+        }
+
+        const auto& group = __winemakers.contains(__rank) ? __winemakers : __students;
+        const auto origin = message.payload.origin;
+        auto copy = message;
+        copy.sender = __rank;
+        send_children(copy, origin, group, position_of(__rank, origin, group));
+    }
+
+    auto Overlay::concerns(const Message& message) -> bool {
+        return message.type == Message::Type::WINEMAKER_BROADCAST || message.type == Message::Type::STUDENT_BROADCAST;
+    }
+
+    auto Overlay::send_children(const Message& message, uint64_t origin, const Group& group, uint64_t position) const -> void {
+        const auto size = size_of(origin, group);
+        for (auto child = __arity * position + 1; child <= __arity * position + __arity && child < size; ++child) {
+            const auto receiver = rank_at(child, origin, group);
+            debug("ACTOR #{} passes broadcast {{ origin: {}, safehouse: {} }} to #{}", __rank, origin, message.payload.safehouse_index, receiver);
+            message.send_to(receiver);
+        }
+    }
+
+    auto Overlay::bind(Overlay* overlay) -> void {
+        __current = overlay;
+    }
+
+    auto Overlay::current() -> Overlay* {
+        return __current;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include "message.hpp"
+
+namespace nouveaux {
+
+    // Broadcasts carried along k-ary trees instead of straight from the broadcaster to every receiver.
+    //
+    // Every role (winemakers, students) forms its own tree rooted at the broadcaster: broadcaster
+    // takes position 0 and members follow in rank order starting right after it, children of position
+    // `p` are positions `k * p + 1` to `k * p + k`. Receiver finds its children from its own role and
+    // the `origin` of the broadcast alone, so sender pays `k` sends instead of one per receiver.
+    //
+    // Forwarded broadcast keeps the broadcaster's timestamp and origin, receivers see the same message
+    // as if it came straight from the broadcaster (only `sender` tells the parent).
+    class Overlay {
+      public:
+        // Role of consecutive actor ids.
+        struct Group {
+            uint64_t start_id;
+            uint64_t count;
+
+            [[nodiscard]] auto contains(uint64_t rank) const -> bool { return rank >= start_id && rank < start_id + count; }
+        };
+
+      private:
+        // Number of children of every tree node.
+        const uint64_t __arity;
+        // Process's own id.
+        const uint32_t __rank;
+        const Group __winemakers;
+        const Group __students;
+
+      public:
+        Overlay(uint64_t arity, uint32_t rank, const Group& winemakers, const Group& students);
+        Overlay(const Overlay&) = delete;
+        auto operator=(const Overlay&) -> Overlay& = delete;
+
+        // Broadcasts message of this process to every other member of `group`.
+        auto send(const Message& message, const Group& group) const -> void;
+        // Passes received broadcast on to children of this process, ignores any other message.
+        auto forward(const Message& message) const -> void;
+        [[nodiscard]] static auto concerns(const Message& message) -> bool;
+
+        static auto bind(Overlay* overlay) -> void;
+        // nullptr when broadcasts go straight to every receiver.
+        [[nodiscard]] static auto current() -> Overlay*;
+
+      private:
+        // Sends message to children of tree node at `position` of `group` tree rooted at `origin`.
+        auto send_children(const Message& message, uint64_t origin, const Group& group, uint64_t position) const -> void;
+    };
+}
@@ -0,0 +1,80 @@
+#include "progress_transport.hpp"
+
+#include <thread>
+
+namespace nouveaux {
+
+    auto ProgressTransport::send(const Message& message, uint64_t receiver) -> void {
+        __engine.post({ message, receiver, nullptr });
+    }
+
+    auto ProgressTransport::send(const Message& message, Fanout& fanout) -> void {
+        auto& state = fanout.state();
+        if (!state) {
+            state = std::make_unique<Mirror>(__engine.mirror(fanout));
+        }
+        __engine.post({ message, 0, &static_cast<Mirror&>(*state).fanout });
+    }
+
+    auto ProgressTransport::respond_with(Responder responder) -> void {
+        __engine.respond_with(std::move(responder));
+    }
+
+    ProgressTransport::Engine::Engine(MpiTransport& transport)
+      : __transport(transport),
+        __network(1),
+        __outbox(),
+        __fanouts(),
+        __mutex(),
+        __responder(nullptr) {}
+
+    auto ProgressTransport::Engine::mirror(const Fanout& fanout) -> Fanout& {
+        std::lock_guard<std::mutex> lock(__mutex);
+        return __fanouts.emplace_back(fanout.receivers());
+    }
+
+    auto ProgressTransport::Engine::respond_with(Responder responder) -> void {
+        std::lock_guard<std::mutex> lock(__mutex);
+        __responder = std::move(responder);
+    }
+
+    auto ProgressTransport::Engine::serve(const std::atomic<bool>& running) -> void {
+        uint64_t idle = 0;
+        while (running.load(std::memory_order_acquire)) {
+            const auto busy = flush() | poll();
+            // Actor parks on its mailbox, only this thread keeps spinning. Yield once there is nothing to do.
+            idle = busy ? 0 : idle + 1;
+            if (idle > 64) {
+                std::this_thread::yield();
+            }
+        }
+        flush();
+    }
+
+    auto ProgressTransport::Engine::flush() -> bool {
+        auto busy = false;
+        Outgoing outgoing;
+        while (__outbox.try_pop(outgoing)) {
+            busy = true;
+            if (outgoing.fanout != nullptr) {
+                __transport.send(outgoing.message, *outgoing.fanout);
+            } else {
+                __transport.send(outgoing.message, outgoing.receiver);
+            }
+        }
+        return busy;
+    }
+
+    auto ProgressTransport::Engine::poll() -> bool {
+        auto busy = false;
+        Message message;
+        while (__transport.try_receive(message)) {
+            busy = true;
+            std::lock_guard<std::mutex> lock(__mutex);
+            if (!__responder || !__responder(message)) {
+                __network.mailbox(0).push(message);
+            }
+        }
+        return busy;
+    }
+}
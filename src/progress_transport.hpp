@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "local_transport.hpp"
+#include "mailbox.hpp"
+#include "mpi_transport.hpp"
+
+namespace nouveaux {
+
+    // Actor side of MPI transport driven by a progress thread, one actor per rank.
+    //
+    // Progress thread makes all MPI calls (`MPI_THREAD_FUNNELED` suffices when it's the main thread). It sends what
+    // the actor queued, receives messages and offers each one to the responder registered by the actor's protocol.
+    // Requests that can be answered right away are answered there, so local work of the actor never delays them.
+    // Everything else is queued in the actor's mailbox.
+    class ProgressTransport : public LocalTransport {
+      public:
+        // Message queued by the actor, goes either to `receiver` or to every receiver of `fanout`.
+        struct Outgoing {
+            Message message;
+            uint64_t receiver;
+            Fanout* fanout;
+        };
+
+        class Engine {
+            MpiTransport& __transport;
+            // Actor's mailbox.
+            LocalTransport::Network __network;
+            BasicMailbox<Outgoing> __outbox;
+            // Copies of actor's fan-outs, their persistent requests are used only by progress thread.
+            std::deque<Fanout> __fanouts;
+            std::mutex __mutex;
+            Responder __responder;
+
+          public:
+            explicit Engine(MpiTransport& transport);
+            Engine(const Engine&) = delete;
+            auto operator=(const Engine&) -> Engine& = delete;
+
+            [[nodiscard]] auto network() -> LocalTransport::Network& { return __network; }
+            // Safe to call from any thread.
+            auto post(Outgoing outgoing) -> void { __outbox.push(std::move(outgoing)); }
+            // Fan-out owned by the engine with the same receivers, it outlives the actor's one.
+            [[nodiscard]] auto mirror(const Fanout& fanout) -> Fanout&;
+            auto respond_with(Responder responder) -> void;
+
+            // Progress loop, runs on the thread owning the MPI transport until `running` is false.
+            auto serve(const std::atomic<bool>& running) -> void;
+
+          private:
+            // Returns whether anything was sent or received.
+            auto flush() -> bool;
+            auto poll() -> bool;
+        };
+
+      private:
+        // Engine's copy of actor's fan-out.
+        struct Mirror : public Fanout::State {
+            Fanout& fanout;
+
+            explicit Mirror(Fanout& fanout)
+              : fanout(fanout) {}
+        };
+
+        Engine& __engine;
+
+      public:
+        explicit ProgressTransport(Engine& engine)
+          : LocalTransport(engine.network(), 0),
+            __engine(engine) {}
+
+        auto send(const Message& message, uint64_t receiver) -> void override;
+        auto send(const Message& message, Fanout& fanout) -> void override;
+        auto respond_with(Responder responder) -> void override;
+    };
+}
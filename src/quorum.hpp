@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace nouveaux {
+
+    // Maekawa-style grid quorum.
+    //
+    // Processes are laid out row by row on a `side` x `side` grid (side = ceil(sqrt(count))).
+    // Quorum of a process consists of every process in its row and every process in its column.
+    // Cells past the last process wrap around (modulo `count`), so for any two processes `i` and `j`
+    // cell (row(i), column(j)) belongs to both quorums, which is all mutual exclusion needs.
+    //
+    // Returned indices are relative (0..count) and sorted, process itself is always included.
+    inline auto grid_quorum(uint64_t index, uint64_t count) -> std::vector<uint64_t> {
+        std::vector<uint64_t> quorum;
+        if (count == 0)
+            return quorum;
+
+        auto side = static_cast<uint64_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+        auto rows = (count + side - 1) / side;
+        auto row = index / side;
+        auto column = index % side;
+
+        quorum.reserve(side + rows);
+        for (uint64_t c = 0; c < side; ++c)
+            quorum.push_back((row * side + c) % count);
+        for (uint64_t r = 0; r < rows; ++r)
+            quorum.push_back((r * side + column) % count);
+
+        std::sort(quorum.begin(), quorum.end());
+        quorum.erase(std::unique(quorum.begin(), quorum.end()), quorum.end());
+
+        return quorum;
+    }
+}
@@ -0,0 +1,563 @@
+#include "quorum_exclusion.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include "logger.hpp"
+#include "quorum.hpp"
+#include "termination.hpp"
+
+#define format(fmt) "[{:0>10}] STUDENT #{} " fmt, __clock.load(std::memory_order_relaxed), __rank
+
+namespace nouveaux {
+    namespace {
+        // Request priority, lower Lamport timestamp wins, ties are broken by lower rank.
+        auto precedes(const Message& lhs, const Message& rhs) -> bool {
+            return lhs.timestamp < rhs.timestamp || (lhs.timestamp == rhs.timestamp && lhs.sender < rhs.sender);
+        }
+
+        auto quorum_of(uint32_t rank, uint64_t students_start_id, uint64_t students_count) -> std::vector<uint64_t> {
+            auto quorum = grid_quorum(rank - students_start_id, students_count);
+            for (auto&& member : quorum)
+                member += students_start_id;
+            return quorum;
+        }
+
+        auto peers_of(uint32_t rank, const std::vector<uint64_t>& quorum) -> std::vector<uint64_t> {
+            std::vector<uint64_t> peers;
+            std::copy_if(quorum.begin(), quorum.end(), std::back_inserter(peers), [&](auto&& member) { return member != rank; });
+            return peers;
+        }
+    }
+
+    QuorumExclusion::QuorumExclusion(std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t students_start_id, uint64_t students_count)
+      : Exclusion(clock, rank),
+        __safehouse(0),
+        __stock(NO_STOCK),
+        __stocked_at(0),
+        __deferred({}),
+        __requests(safehouse_count),
+        __quorum(quorum_of(rank, students_start_id, students_count)),
+        __locks(safehouse_count),
+        __outboxes(students_count),
+        __students_start_id(students_start_id),
+        __known_at(safehouse_count, 0),
+        __unhandled(students_count, 0),
+        __mutex(),
+        __request_fanout(peers_of(rank, __quorum)),
+        __release_fanout(peers_of(rank, __quorum)),
+        __release_request_fanout(peers_of(rank, __quorum)) {
+        trace(format("QUORUM SIZE: {}"), __quorum.size());
+        Transport::current().respond_with([this](const Message& message) { return respond(message); });
+    }
+
+    QuorumExclusion::~QuorumExclusion() {
+        Transport::current().respond_with(nullptr);
+    }
+
+    auto QuorumExclusion::acquire(uint64_t safehouse, const Observer& observer) -> bool {
+        __safehouse = safehouse;
+        send_req(safehouse, ++__clock);
+
+        while (!granted(safehouse)) {
+            auto message = receive();
+            handle(message);
+            if (observer(message)) {
+                // Withdraw request, arbiters drop it from their queues or free the grant.
+                send_release(safehouse);
+                return false;
+            }
+            trace(format("ACK COUNTER: {}"), __requests[safehouse].ack_counter);
+        }
+        return true;
+    }
+
+    auto QuorumExclusion::acquire_batch(const std::vector<uint64_t>& safehouses, const Observer& observer, const Enter& enter) -> uint64_t {
+        const auto priority = ++__clock;
+        for (size_t i = 0; i < safehouses.size(); ++i) {
+            send_req(safehouses[i], priority, safehouses.size() - 1 - i);
+        }
+
+        auto pending = safehouses;
+        uint64_t entered = 0;
+        while (!pending.empty()) {
+            if (auto safehouse = std::find_if(pending.begin(), pending.end(), [this](auto&& s) { return granted(s); }); safehouse != pending.end()) {
+                __safehouse = *safehouse;
+                pending.erase(safehouse);
+                ++entered;
+                const auto more = enter(__safehouse);
+                release();
+                if (!more) {
+                    break;
+                }
+                continue;
+            }
+
+            auto message = receive();
+            handle(message);
+            if (observer(message)) {
+                break;
+            }
+        }
+
+        for (auto&& safehouse : pending) {
+            send_release(safehouse);
+        }
+        return entered;
+    }
+
+    auto QuorumExclusion::release() -> void {
+        // Next REQ usually follows right away, release goes out together with it.
+        flush();
+        __deferred = release_of(__safehouse, __stock, __stocked_at);
+        __stock = NO_STOCK;
+    }
+
+    auto QuorumExclusion::flush() -> void {
+        if (__deferred.type == Message::Type::UNKNOWN) {
+            return;
+        }
+        __loopback.push_back(__deferred);
+        __deferred.send_to(__release_fanout);
+        __deferred = {};
+    }
+
+    auto QuorumExclusion::split(const Message& message) -> std::pair<Message, Message> {
+        Message release {
+            /* .type = */ Message::Type::STUDENT_RELEASE,
+            /* .sender = */ message.sender,
+            /* .timestamp = */ message.timestamp,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ message.payload.released_index,
+              /* .wine_volume = */ message.payload.wine_volume,
+              /* .last_timestamp = */ message.payload.last_timestamp,
+              /* .origin = */ message.payload.origin,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            }
+        };
+        Message request {
+            /* .type = */ Message::Type::STUDENT_REQUEST,
+            /* .sender = */ message.sender,
+            /* .timestamp = */ message.timestamp,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ message.payload.safehouse_index,
+              /* .wine_volume = */ 0,
+              /* .last_timestamp = */ 0,
+              /* .origin = */ message.payload.origin,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ message.payload.stocked_at,
+              /* .batch = */ message.payload.batch,
+            }
+        };
+        return { release, request };
+    }
+
+    auto QuorumExclusion::safehouses_of(const Message& reply) -> std::vector<uint64_t> {
+        std::vector<uint64_t> safehouses { reply.payload.safehouse_index };
+        for (uint64_t bit = 0; bit < 64; ++bit) {
+            if (reply.payload.batch & (uint64_t(1) << bit)) {
+                safehouses.push_back(reply.payload.safehouse_index + 1 + bit);
+            }
+        }
+        return safehouses;
+    }
+
+    auto QuorumExclusion::report(uint64_t stock) -> void {
+        __stock = stock;
+        __stocked_at = __clock;
+        learn(__safehouse, __clock);
+    }
+
+    auto QuorumExclusion::learn(uint64_t safehouse, uint64_t at) -> void {
+        __known_at[safehouse] = std::max(__known_at[safehouse], at);
+    }
+
+    auto QuorumExclusion::granted(uint64_t safehouse) const -> bool {
+        return __requests[safehouse].ack_counter == __quorum.size();
+    }
+
+    auto QuorumExclusion::handle(const Message& message) -> void {
+        std::lock_guard<std::mutex> lock(__mutex);
+        if (message.sender >= __students_start_id && message.sender - __students_start_id < __unhandled.size() && message.sender != __rank) {
+            auto& unhandled = __unhandled[message.sender - __students_start_id];
+            if (unhandled > 0) {
+                --unhandled;
+            }
+        }
+        dispatch(message);
+    }
+
+    auto QuorumExclusion::respond(const Message& message) -> bool {
+        std::lock_guard<std::mutex> lock(__mutex);
+        // Termination messages are taken before `handle`, they must not hold back student's requests.
+        if (message.sender < __students_start_id || message.sender - __students_start_id >= __unhandled.size() || Termination::concerns(message)) {
+            return false;
+        }
+
+        auto& unhandled = __unhandled[message.sender - __students_start_id];
+        if (unhandled == 0 && !__outboxes[message.sender - __students_start_id].holding) {
+            if (message.type == Message::Type::STUDENT_RELEASE) {
+                static_cast<void>(vacate(message));
+            } else if (message.type == Message::Type::STUDENT_REQUEST) {
+                grant(message);
+            } else if (message.type == Message::Type::STUDENT_RELEASE_REQUEST) {
+                // Lock granted again to the same student would be freed once more when the actor gets to the release.
+                const auto [release, request] = split(message);
+                if (vacate(release) && request.payload.safehouse_index != release.payload.safehouse_index) {
+                    grant(request);
+                }
+            }
+        }
+        ++unhandled;
+        return false;
+    }
+
+    auto QuorumExclusion::vacate(const Message& release) -> bool {
+        auto& lock = __locks[release.payload.safehouse_index];
+        if (!lock.locked || lock.holder.sender != release.sender || !lock.queue.empty()) {
+            return false;
+        }
+        debug("[PROGRESS] STUDENT #{} frees STUDENT RELEASE {{ timestamp: {}, sender: {}, safehouse: {} }}", __rank, release.timestamp, release.sender, release.payload.safehouse_index);
+        if (release.payload.wine_volume != NO_STOCK && release.payload.last_timestamp > lock.stocked_at) {
+            lock.stock = release.payload.wine_volume;
+            lock.stocked_at = release.payload.last_timestamp;
+        }
+        lock.locked = false;
+        return true;
+    }
+
+    auto QuorumExclusion::grant(const Message& request) -> void {
+        auto& lock = __locks[request.payload.safehouse_index];
+        if (lock.locked || request.payload.batch != 0) {
+            return;
+        }
+        // Clock is shared with the actor, ACK comes after the request and everything this rank sent before.
+        // Stock reported by the previous holder has to precede whatever the new one reports, so it's stamped after that too.
+        debug("[PROGRESS] STUDENT #{} grants STUDENT REQUEST {{ timestamp: {}, sender: {}, safehouse: {} }}", __rank, request.timestamp, request.sender, request.payload.safehouse_index);
+        lock.locked = true;
+        lock.inquired = false;
+        lock.holder = request;
+        const auto timestamp = tick(std::max(request.timestamp, lock.stocked_at));
+        const auto news = lock.stocked_at > request.payload.stocked_at;
+        Message ack {
+            /* .type = */ Message::Type::STUDENT_ACKNOWLEDGE,
+            /* .sender = */ __rank,
+            /* .timestamp = */ timestamp,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ request.payload.safehouse_index,
+              /* .wine_volume = */ news ? lock.stock : 0,
+              /* .last_timestamp = */ request.timestamp,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ news ? lock.stocked_at : 0,
+              /* .batch = */ 0,
+            }
+        };
+        ack.send_to(request.sender);
+    }
+
+    auto QuorumExclusion::dispatch(const Message& message) -> void {
+        switch (message.type) {
+            case Message::Type::WINEMAKER_BROADCAST:
+                learn(message.payload.safehouse_index, message.timestamp);
+                break;
+            case Message::Type::STUDENT_REQUEST: {
+                debug(format("received STUDENT REQUEST {{ timestamp: {}, sender: {}, safehouse: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index);
+                // Rest of the batch follows right away, replies wait for it.
+                auto& outbox = __outboxes[message.sender - __students_start_id];
+                // Progress thread granted it already.
+                const auto& holder = __locks[message.payload.safehouse_index].holder;
+                if (__locks[message.payload.safehouse_index].locked && holder.sender == message.sender && holder.timestamp == message.timestamp) {
+                    break;
+                }
+                outbox.holding = message.payload.batch != 0;
+                arbitrate(message);
+                if (!outbox.holding) {
+                    send_held(message.sender);
+                }
+                break;
+            }
+            case Message::Type::STUDENT_RELEASE_REQUEST: {
+                const auto [release, request] = split(message);
+                dispatch(release);
+                dispatch(request);
+                break;
+            }
+            case Message::Type::STUDENT_RELEASE: {
+                debug(format("received STUDENT RELEASE {{ timestamp: {}, sender: {}, safehouse: {}, stock: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.wine_volume);
+                auto& lock = __locks[message.payload.safehouse_index];
+                if (message.payload.wine_volume != NO_STOCK && message.payload.last_timestamp > lock.stocked_at) {
+                    lock.stock = message.payload.wine_volume;
+                    lock.stocked_at = message.payload.last_timestamp;
+                }
+                if (message.payload.wine_volume != NO_STOCK) {
+                    learn(message.payload.safehouse_index, message.payload.last_timestamp);
+                }
+                if (lock.locked && lock.holder.sender == message.sender) {
+                    unlock(message.payload.safehouse_index);
+                } else {
+                    // Request was withdrawn before it got the grant.
+                    lock.queue.erase(std::remove_if(lock.queue.begin(), lock.queue.end(), [&](auto&& waiting) { return waiting.request.sender == message.sender; }), lock.queue.end());
+                }
+                break;
+            }
+            case Message::Type::STUDENT_RELINQUISH: {
+                debug(format("received STUDENT RELINQUISH {{ timestamp: {}, sender: {}, safehouse: {}, request timestamp: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.last_timestamp);
+                auto& lock = __locks[message.payload.safehouse_index];
+                if (lock.locked && lock.holder.sender == message.sender && lock.holder.timestamp == message.payload.last_timestamp) {
+                    lock.queue.push_back({ lock.holder, true });
+                    unlock(message.payload.safehouse_index);
+                }
+                break;
+            }
+            case Message::Type::STUDENT_ACKNOWLEDGE:
+                if (message.payload.stocked_at != 0) {
+                    learn(message.payload.safehouse_index, message.payload.stocked_at);
+                }
+                for (auto&& safehouse : safehouses_of(message)) {
+                    auto& request = __requests[safehouse];
+                    if (message.payload.last_timestamp == request.priority) {
+                        debug(format("received STUDENT ACKNOWLEDGE {{ timestamp: {}, sender: {}, safehouse: {}, request timestamp: {} }}"), message.timestamp, message.sender, safehouse, message.payload.last_timestamp);
+                        request.grants.push_back(message.sender);
+                        ++request.ack_counter;
+                    }
+                }
+                break;
+            case Message::Type::STUDENT_FAILED:
+                for (auto&& safehouse : safehouses_of(message)) {
+                    auto& request = __requests[safehouse];
+                    if (message.payload.last_timestamp == request.priority) {
+                        debug(format("received STUDENT FAILED {{ timestamp: {}, sender: {}, safehouse: {}, request timestamp: {} }}"), message.timestamp, message.sender, safehouse, message.payload.last_timestamp);
+                        request.failed = true;
+                        for (auto&& arbiter : request.inquiries) {
+                            relinquish(safehouse, arbiter);
+                        }
+                        request.inquiries.clear();
+                    }
+                }
+                break;
+            case Message::Type::STUDENT_INQUIRE: {
+                auto& request = __requests[message.payload.safehouse_index];
+                // Inquiries that arrive after all grants were collected are answered by release.
+                if (message.payload.last_timestamp == request.priority && request.ack_counter < __quorum.size()) {
+                    debug(format("received STUDENT INQUIRE {{ timestamp: {}, sender: {}, safehouse: {}, request timestamp: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.last_timestamp);
+                    if (request.failed) {
+                        relinquish(message.payload.safehouse_index, message.sender);
+                    } else {
+                        request.inquiries.push_back(message.sender);
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    auto QuorumExclusion::arbitrate(const Message& request) -> void {
+        auto& lock = __locks[request.payload.safehouse_index];
+        if (!lock.locked) {
+            lock.locked = true;
+            lock.inquired = false;
+            lock.holder = request;
+            send_reply(Message::Type::STUDENT_ACKNOWLEDGE, request);
+            return;
+        }
+
+        const auto highest = precedes(request, lock.holder) && std::none_of(lock.queue.begin(), lock.queue.end(), [&](auto&& waiting) { return precedes(waiting.request, request); });
+        if (highest) {
+            // Everyone already waiting has to step back for this request.
+            for (auto&& waiting : lock.queue) {
+                if (!waiting.failed) {
+                    send_reply(Message::Type::STUDENT_FAILED, waiting.request);
+                    waiting.failed = true;
+                }
+            }
+            lock.queue.push_back({ request, false });
+            if (!lock.inquired) {
+                lock.inquired = true;
+                send_reply(Message::Type::STUDENT_INQUIRE, lock.holder);
+            }
+        } else {
+            lock.queue.push_back({ request, true });
+            send_reply(Message::Type::STUDENT_FAILED, request);
+        }
+    }
+
+    auto QuorumExclusion::unlock(uint64_t safehouse) -> void {
+        auto& lock = __locks[safehouse];
+        lock.locked = false;
+        if (lock.queue.empty()) {
+            return;
+        }
+
+        auto next = std::min_element(lock.queue.begin(), lock.queue.end(), [](auto&& lhs, auto&& rhs) { return precedes(lhs.request, rhs.request); });
+        lock.locked = true;
+        lock.inquired = false;
+        lock.holder = next->request;
+        lock.queue.erase(next);
+        send_reply(Message::Type::STUDENT_ACKNOWLEDGE, lock.holder);
+
+        // Remaining requests have lower priority than the new holder.
+        for (auto&& waiting : lock.queue) {
+            if (!waiting.failed) {
+                send_reply(Message::Type::STUDENT_FAILED, waiting.request);
+                waiting.failed = true;
+            }
+        }
+    }
+
+    auto QuorumExclusion::relinquish(uint64_t safehouse, uint64_t arbiter) -> void {
+        auto& request = __requests[safehouse];
+        auto grant = std::find(request.grants.begin(), request.grants.end(), arbiter);
+        if (grant == request.grants.end()) {
+            return;
+        }
+
+        request.grants.erase(grant);
+        --request.ack_counter;
+
+        Message relinquish {
+            /* .type = */ Message::Type::STUDENT_RELINQUISH,
+            /* .sender = */ __rank,
+            /* .timestamp = */ ++__clock,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ safehouse,
+              /* .wine_volume = */ 0,
+              /* .last_timestamp = */ request.priority,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            }
+        };
+
+        send(relinquish, arbiter);
+    }
+
+    auto QuorumExclusion::send_req(uint64_t safehouse, uint64_t priority, uint64_t batch) -> void {
+        __requests[safehouse] = Request { priority, 0, {}, false, {} };
+
+        Message request {
+            Message::Type::STUDENT_REQUEST,
+            __rank,
+            priority,
+            Message::Payload {
+              safehouse,
+              0,
+              0,
+              __rank,
+              0,
+              __known_at[safehouse],
+              batch,
+            },
+        };
+
+        if (__deferred.type == Message::Type::UNKNOWN) {
+            // Student is always a member of its own quorum.
+            __loopback.push_back(request);
+            request.send_to(__request_fanout);
+            return;
+        }
+
+        // Own arbiter takes them apart right away, peers get them in one message.
+        __loopback.push_back(__deferred);
+        __loopback.push_back(request);
+        request.type = Message::Type::STUDENT_RELEASE_REQUEST;
+        request.payload.wine_volume = __deferred.payload.wine_volume;
+        request.payload.last_timestamp = __deferred.payload.last_timestamp;
+        request.payload.released_index = __deferred.payload.safehouse_index;
+        request.send_to(__release_request_fanout);
+        __deferred = {};
+    }
+
+    auto QuorumExclusion::send_reply(Message::Type type, const Message& request) -> void {
+        // Grant comes with the freshest stock this arbiter knows of, unless requester knew it already.
+        const auto& lock = __locks[request.payload.safehouse_index];
+        const auto ack = type == Message::Type::STUDENT_ACKNOWLEDGE && lock.stocked_at > request.payload.stocked_at;
+        // Progress thread may have taken the stock from a release the actor didn't receive yet.
+        Message reply {
+            /* .type = */ type,
+            /* .sender = */ __rank,
+            /* .timestamp = */ tick(lock.stocked_at),
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ request.payload.safehouse_index,
+              /* .wine_volume = */ ack ? lock.stock : 0,
+              /* .last_timestamp = */ request.timestamp,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ ack ? lock.stocked_at : 0,
+              /* .batch = */ 0,
+            }
+        };
+
+        auto& outbox = __outboxes[request.sender - __students_start_id];
+        if (outbox.holding) {
+            outbox.replies.push_back(reply);
+            return;
+        }
+        send(reply, request.sender);
+    }
+
+    auto QuorumExclusion::send_held(uint64_t requester) -> void {
+        auto& outbox = __outboxes[requester - __students_start_id];
+        outbox.holding = false;
+        std::vector<Message> replies;
+        for (auto&& reply : outbox.replies) {
+            // Reply joins an earlier one of the same kind if it carries no stock news and doesn't overtake
+            // anything concerning the same safehouse.
+            const auto safehouse = reply.payload.safehouse_index;
+            const auto mergeable = (reply.type == Message::Type::STUDENT_ACKNOWLEDGE || reply.type == Message::Type::STUDENT_FAILED) && reply.payload.stocked_at == 0;
+            auto merged = replies.rbegin();
+            for (; mergeable && merged != replies.rend(); ++merged) {
+                const auto base = merged->payload.safehouse_index;
+                if (merged->type == reply.type && merged->payload.last_timestamp == reply.payload.last_timestamp && base < safehouse && safehouse - base <= 64) {
+                    break;
+                }
+                const auto concerned = safehouses_of(*merged);
+                if (std::find(concerned.begin(), concerned.end(), safehouse) != concerned.end()) {
+                    merged = replies.rend();
+                    break;
+                }
+            }
+            if (mergeable && merged != replies.rend()) {
+                merged->payload.batch |= uint64_t(1) << (safehouse - merged->payload.safehouse_index - 1);
+                continue;
+            }
+            replies.push_back(reply);
+        }
+        outbox.replies.clear();
+        for (auto&& reply : replies) {
+            send(reply, requester);
+        }
+    }
+
+    auto QuorumExclusion::send_release(uint64_t safehouse, uint64_t stock, uint64_t stocked_at) -> void {
+        flush();
+        const auto release = release_of(safehouse, stock, stocked_at);
+        __loopback.push_back(release);
+        release.send_to(__release_fanout);
+    }
+
+    auto QuorumExclusion::release_of(uint64_t safehouse, uint64_t stock, uint64_t stocked_at) -> Message {
+        Message release {
+            /* .type = */ Message::Type::STUDENT_RELEASE,
+            /* .sender = */ __rank,
+            /* .timestamp = */ ++__clock,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ safehouse,
+              /* .wine_volume = */ stock,
+              /* .last_timestamp = */ stocked_at,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            }
+        };
+
+        __requests[safehouse] = Request { 0, 0, {}, false, {} };
+        return release;
+    }
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "exclusion.hpp"
+
+namespace nouveaux {
+
+    // Students' permission protocol: Maekawa grid quorum with per safehouse arbiter locks.
+    //
+    // Student enters once every member of its quorum (itself included) granted the request.
+    // Deadlocks between overlapping quorums are resolved with INQUIRE / RELINQUISH / FAILED.
+    //
+    // Batch sends REQs for all its safehouses with one timestamp, each safehouse is entered as soon as
+    // its own quorum grants it. Every REQ tells how many more of the batch follow, arbiter holds its replies
+    // to the requester until the last one came and sends consecutive ACKs (or FAILEDs) as one message.
+    //
+    // RELEASE of an entered safehouse tells the quorum how much stock was left, stamped with the clock at the
+    // time it was reported. Critical sections of a safehouse are causally ordered, so the higher stamp is the
+    // fresher news. Arbiters keep the freshest one and pass it on with every ACK: quorums intersect, so at least
+    // one arbiter granting the next holder got the previous holder's RELEASE first. REQ carries the freshest
+    // stamp requester knows of, ACK brings nothing requester already knows, so it can be merged.
+    //
+    // Student usually requests another safehouse right after releasing one and both go to the same quorum,
+    // so the RELEASE is held back and piggybacked on the next REQ (STUDENT_RELEASE_REQUEST). It's sent
+    // on its own before the student could block waiting for anything.
+    //
+    // With transport progress thread, requests for free locks are granted there right away and releases
+    // nobody waits for take effect there. Arbiter state is then shared between the threads and guarded by `__mutex`.
+    class QuorumExclusion : public Exclusion {
+#if defined(NOUVEAUX_DEBUG)
+      public:
+#endif
+        struct Request {
+            // Lamport clock state for sent REQ message, zero when safehouse isn't requested.
+            // Safehouses requested together share it.
+            uint64_t priority;
+            // Number of received ACKs (grants).
+            uint64_t ack_counter;
+            // Ranks of quorum members which currently grant the request.
+            std::vector<uint64_t> grants;
+            // Whether any quorum member responded with STUDENT_FAILED to the request.
+            // Only then is it safe to relinquish grants on STUDENT_INQUIRE.
+            bool failed;
+            // Ranks of arbiters which sent STUDENT_INQUIRE before we knew whether to yield.
+            std::vector<uint64_t> inquiries;
+        };
+        // Currently held safehouse index.
+        //
+        // MUTABILITY: Should change only when safehouse is entered.
+        uint64_t __safehouse;
+        // Stock reported for the held safehouse, NO_STOCK until the actor reports it.
+        //
+        // MUTABILITY: Should change only when stock is reported and when held safehouse is released.
+        uint64_t __stock;
+        // Lamport clock state when `__stock` was reported.
+        uint64_t __stocked_at;
+        // RELEASE of the last entered safehouse waiting for the next REQ, UNKNOWN type when there is none.
+        //
+        // MUTABILITY: Should change only when entered safehouse is released and when it's sent.
+        Message __deferred;
+        // Per safehouse request state, requests for different safehouses are independent.
+        //
+        // MUTABILITY: Should change only:
+        //     1) When REQ or RELEASE message is being sent.
+        //     2) When received STUDENT_ACKNOWLEDGE, STUDENT_FAILED or STUDENT_INQUIRE message for pending request.
+        //     3) When grant is relinquished back to arbiter after STUDENT_INQUIRE.
+        std::vector<Request> __requests;
+        // Ranks of students whose permission is required to enter critical section (including self).
+        // Every two quorums intersect, see `grid_quorum`.
+        const std::vector<uint64_t> __quorum;
+        // Arbiter side of quorum protocol. Every student arbitrates every safehouse for students that
+        // have it in their quorum. Locks for different safehouses are independent, so students
+        // acquiring different safehouses never wait for each other.
+        struct Lock {
+            // Whether grant for this safehouse is currently given out.
+            bool locked;
+            // Whether current grant holder was already asked to yield.
+            bool inquired;
+            // Request which currently holds the grant.
+            Message holder;
+            // Requests waiting for the grant, `failed` is set once requester was told it has to wait.
+            struct Waiting {
+                Message request;
+                bool failed;
+            };
+            std::vector<Waiting> queue;
+            // Stock left by the latest holder which reported any and the time it reported it, zero before that.
+            uint64_t stock;
+            uint64_t stocked_at;
+        };
+        // Per safehouse arbiter state.
+        //
+        // MUTABILITY: Should change only when received STUDENT_REQUEST, STUDENT_RELEASE or STUDENT_RELINQUISH message.
+        std::vector<Lock> __locks;
+        // Replies to a requester whose batch of REQs is still coming in.
+        struct Outbox {
+            bool holding;
+            std::vector<Message> replies;
+        };
+        // Per student arbiter outbox, indexed by rank relative to first student.
+        //
+        // MUTABILITY: Should change only when received STUDENT_REQUEST message and when reply is sent.
+        std::vector<Outbox> __outboxes;
+        const uint64_t __students_start_id;
+        // Stamp of the freshest stock news seen per safehouse, zero when there was none.
+        //
+        // MUTABILITY: Should change only when stock is reported or news of it is received.
+        std::vector<uint64_t> __known_at;
+        // Messages of corresponding student received but not handled yet. Progress thread grants request only
+        // when there are none, otherwise it could overtake a message changing the lock.
+        //
+        // MUTABILITY: Should change only when student's message is passed to the actor or handled.
+        std::vector<uint64_t> __unhandled;
+        // Guards arbiter state (`__locks`, `__outboxes`) and the above once progress thread may grant requests.
+        std::mutex __mutex;
+        // Persistent sends of REQ messages to quorum (excluding self).
+        Transport::Fanout __request_fanout;
+        // Persistent sends of RELEASE messages to quorum (excluding self).
+        Transport::Fanout __release_fanout;
+        // Persistent sends of REQ messages carrying RELEASE to quorum (excluding self).
+        Transport::Fanout __release_request_fanout;
+
+      public:
+        QuorumExclusion(std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t students_start_id, uint64_t students_count);
+        ~QuorumExclusion() override;
+
+        auto handle(const Message& message) -> void override;
+        [[nodiscard]] auto acquire(uint64_t safehouse, const Observer& observer) -> bool override;
+        [[nodiscard]] auto acquire_batch(const std::vector<uint64_t>& safehouses, const Observer& observer, const Enter& enter) -> uint64_t override;
+        auto release() -> void override;
+        auto report(uint64_t stock) -> void override;
+
+        // RELEASE and REQ carried by STUDENT_RELEASE_REQUEST, in the order they take effect.
+        [[nodiscard]] static auto split(const Message& message) -> std::pair<Message, Message>;
+        // Safehouses merged reply stands for, its own `safehouse_index` first.
+        [[nodiscard]] static auto safehouses_of(const Message& reply) -> std::vector<uint64_t>;
+
+      protected:
+        auto flush() -> void override;
+
+      private:
+        // Progress thread side, frees released locks nobody waits for and grants requests for free ones. Message
+        // still reaches the actor, students count requests towards contention, `handle` then finds the request
+        // already holding the lock and the release a no-op.
+        [[nodiscard]] auto respond(const Message& message) -> bool;
+        // Unlocks lock held by the releasing student if nobody waits for it, returns whether it did.
+        [[nodiscard]] auto vacate(const Message& release) -> bool;
+        // Grants request for free lock unless it's part of a batch.
+        auto grant(const Message& request) -> void;
+        // Handles message of any type once arbiter state is locked.
+        auto dispatch(const Message& message) -> void;
+        [[nodiscard]] auto granted(uint64_t safehouse) const -> bool;
+        auto arbitrate(const Message& request) -> void;
+        auto unlock(uint64_t safehouse) -> void;
+        auto relinquish(uint64_t safehouse, uint64_t arbiter) -> void;
+        // `batch` is the number of REQs still to follow.
+        auto send_req(uint64_t safehouse, uint64_t priority, uint64_t batch = 0) -> void;
+        // Reply is held while requester's batch is incomplete.
+        auto send_reply(Message::Type type, const Message& request) -> void;
+        // Sends replies held for `requester`, merging consecutive ones of the same kind.
+        auto send_held(uint64_t requester) -> void;
+        // Stock news of `safehouse` stamped `at` was seen.
+        auto learn(uint64_t safehouse, uint64_t at) -> void;
+        // Frees grants of `safehouse` or withdraws its pending request.
+        auto send_release(uint64_t safehouse, uint64_t stock = NO_STOCK, uint64_t stocked_at = 0) -> void;
+        // Builds RELEASE message and forgets the request, sending it is up to the caller.
+        [[nodiscard]] auto release_of(uint64_t safehouse, uint64_t stock, uint64_t stocked_at) -> Message;
+    };
+}
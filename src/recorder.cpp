@@ -0,0 +1,220 @@
+#include "recorder.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace nouveaux {
+
+    namespace {
+        thread_local FlightRecorder* __current = nullptr;
+
+        auto power_of_two(uint64_t value) -> uint64_t {
+            uint64_t power = 1;
+            while (power < value)
+                power <<= 1;
+            return power;
+        }
+
+        // Live recorders, dumped together on signal. Guarded by a spin flag rather than a mutex, because
+        // `std::atomic_flag` is always lock-free and so, unlike `std::mutex`, safe to touch in a signal handler.
+        std::atomic_flag __registry_busy = ATOMIC_FLAG_INIT;
+        std::vector<FlightRecorder*> __registry;
+
+        auto lock_registry() -> void {
+            while (__registry_busy.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        auto unlock_registry() -> void {
+            __registry_busy.clear(std::memory_order_release);
+        }
+
+        // Single text line built without allocation, longer lines are truncated.
+        struct Line {
+            char data[1024];
+            size_t size = 0;
+
+            auto put(char c) -> void {
+                if (size < sizeof(data) - 1)
+                    data[size++] = c;
+            }
+
+            auto put(const char* text) -> void {
+                while (*text != '\0')
+                    put(*text++);
+            }
+
+            auto put(uint64_t value, bool negative, char fill, char align, size_t width) -> void {
+                char digits[24];
+                size_t length = 0;
+                do {
+                    digits[length++] = static_cast<char>('0' + value % 10);
+                    value /= 10;
+                } while (value != 0);
+                if (negative)
+                    digits[length++] = '-';
+
+                const auto padding = width > length ? width - length : 0;
+                if (align != '<')
+                    for (size_t i = 0; i < padding; ++i)
+                        put(fill);
+                while (length > 0)
+                    put(digits[--length]);
+                if (align == '<')
+                    for (size_t i = 0; i < padding; ++i)
+                        put(fill);
+            }
+        };
+
+        constexpr char LEVELS[] = { 'T', 'D', 'I', 'W', 'E', 'C', 'O' };
+
+        // Subset of fmt syntax used by log calls: `{}`, `{:<fill><align><width>}`, `{{` and `}}`.
+        auto format_into(Line& line, const FlightRecorder::Record& record) -> void {
+            uint8_t argument = 0;
+            for (auto c = record.format; *c != '\0'; ++c) {
+                if (*c == '}' && c[1] == '}') {
+                    line.put('}');
+                    ++c;
+                    continue;
+                }
+                if (*c != '{') {
+                    line.put(*c);
+                    continue;
+                }
+                if (c[1] == '{') {
+                    line.put('{');
+                    ++c;
+                    continue;
+                }
+
+                char fill = ' ';
+                char align = '>';
+                size_t width = 0;
+                ++c;
+                if (*c == ':') {
+                    ++c;
+                    if (*c != '\0' && (c[1] == '<' || c[1] == '>')) {
+                        fill = *c++;
+                    }
+                    if (*c == '<' || *c == '>') {
+                        align = *c++;
+                    }
+                    while (*c >= '0' && *c <= '9') {
+                        width = width * 10 + (*c++ - '0');
+                    }
+                }
+                while (*c != '\0' && *c != '}')
+                    ++c;
+                if (*c == '\0')
+                    break;
+
+                if (argument < record.count) {
+                    const bool negative = record.negative & (1 << argument);
+                    const auto value = record.arguments[argument];
+                    line.put(negative ? 0 - value : value, negative, fill, align, width);
+                    ++argument;
+                }
+            }
+        }
+
+        auto handle(int signal) -> void {
+            FlightRecorder::dump_all();
+            if (signal != SIGUSR1) {
+                std::signal(signal, SIG_DFL);
+                std::raise(signal);
+            }
+        }
+    }
+
+    FlightRecorder::FlightRecorder(const char* directory, uint64_t rank, uint64_t capacity)
+      : __records(nullptr),
+        __capacity(power_of_two(capacity)),
+        __written(0),
+        __path {} {
+        __records.reset(new Record[__capacity]);
+        std::filesystem::create_directories(directory);
+        std::snprintf(__path, sizeof(__path), "%s/flight_%lu.log", directory, static_cast<unsigned long>(rank));
+
+        lock_registry();
+        __registry.push_back(this);
+        unlock_registry();
+    }
+
+    FlightRecorder::~FlightRecorder() {
+        lock_registry();
+        __registry.erase(std::remove(__registry.begin(), __registry.end(), this), __registry.end());
+        unlock_registry();
+        dump();
+    }
+
+    auto FlightRecorder::dump() const -> void {
+        const auto written = __written.load(std::memory_order_acquire);
+        if (written == 0) {
+            return;
+        }
+
+        auto fd = open(__path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return;
+        }
+
+        const auto first = written > __capacity ? written - __capacity : 0;
+        for (auto position = first; position < written; ++position) {
+            const auto& record = __records[position & (__capacity - 1)];
+            Line line;
+            line.put('[');
+            line.put(LEVELS[std::min<size_t>(record.level, sizeof(LEVELS) - 1)]);
+            line.put("][");
+            line.put(record.time / 1000000000, false, ' ', '>', 6);
+            line.put('.');
+            line.put(record.time % 1000000000, false, '0', '>', 9);
+            line.put("] ");
+            format_into(line, record);
+            line.put('\n');
+            if (write(fd, line.data, line.size) < 0) {
+                break;
+            }
+        }
+
+        close(fd);
+    }
+
+    auto FlightRecorder::bind(FlightRecorder* recorder) -> void {
+        __current = recorder;
+    }
+
+    auto FlightRecorder::current() -> FlightRecorder* {
+        return __current;
+    }
+
+    auto FlightRecorder::install_signal_handlers() -> void {
+        for (auto signal : { SIGUSR1, SIGINT, SIGTERM, SIGABRT, SIGSEGV }) {
+            std::signal(signal, handle);
+        }
+    }
+
+    auto FlightRecorder::dump_all() -> void {
+        // Signal may interrupt a thread that is registering a recorder, never wait for it.
+        if (__registry_busy.test_and_set(std::memory_order_acquire)) {
+            return;
+        }
+        for (auto&& recorder : __registry) {
+            recorder->dump();
+        }
+        unlock_registry();
+    }
+
+    auto FlightRecorder::now() -> uint64_t {
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace nouveaux {
+
+    // In-memory ring buffer of the latest log records of one actor.
+    //
+    // Recording stores the (static) format string pointer and integer arguments, nothing is formatted
+    // or written until the recorder is dumped to `<directory>/flight_<rank>.log`, on request
+    // (see `install_signal_handlers`) or when the recorder is destroyed. Only the owning thread writes,
+    // so recording is a handful of stores without locks or atomic read-modify-writes.
+    class FlightRecorder {
+      public:
+        static constexpr uint8_t MAX_ARGUMENTS = 8;
+
+        struct Record {
+            // Nanoseconds of steady clock.
+            uint64_t time;
+            const char* format;
+            uint64_t arguments[MAX_ARGUMENTS];
+            // spdlog level.
+            uint8_t level;
+            uint8_t count;
+            // Bit set for every argument that is a negative signed value.
+            uint8_t negative;
+        };
+
+      private:
+        std::unique_ptr<Record[]> __records;
+        // Power of two, so that position wraps by masking.
+        const uint64_t __capacity;
+        // Number of records ever written, next one goes to `__written & (__capacity - 1)`.
+        std::atomic<uint64_t> __written;
+        // Dump path, kept as plain characters so that signal handler doesn't allocate.
+        char __path[256];
+
+      public:
+        // `capacity` is rounded up to a power of two.
+        FlightRecorder(const char* directory, uint64_t rank, uint64_t capacity);
+        FlightRecorder(const FlightRecorder&) = delete;
+        auto operator=(const FlightRecorder&) -> FlightRecorder& = delete;
+        ~FlightRecorder();
+
+        template<typename... T>
+        auto record(uint8_t level, const char* format, const T&... arguments) -> void {
+            static_assert(sizeof...(T) <= MAX_ARGUMENTS, "too many log arguments");
+            static_assert((std::is_integral<T>::value && ...), "flight recorder keeps only integer arguments");
+
+            const auto written = __written.load(std::memory_order_relaxed);
+            auto& record = __records[written & (__capacity - 1)];
+            record.time = now();
+            record.format = format;
+            record.level = level;
+            record.count = sizeof...(T);
+            record.negative = 0;
+
+            uint8_t index = 0;
+            ((record.negative |= static_cast<uint8_t>(is_negative(arguments) << index), record.arguments[index++] = static_cast<uint64_t>(arguments)), ...);
+            (void)index;
+
+            // Publishes the record to dumps running on other threads or in signal handlers.
+            __written.store(written + 1, std::memory_order_release);
+        }
+
+        // Writes retained records, oldest first, as text. Async-signal-safe.
+        auto dump() const -> void;
+
+        // Makes `recorder` the one written on calling thread, `nullptr` disables recording.
+        static auto bind(FlightRecorder* recorder) -> void;
+        [[nodiscard]] static auto current() -> FlightRecorder*;
+
+        // Dumps every live recorder on SIGUSR1, and before default action of SIGINT, SIGTERM, SIGABRT and SIGSEGV.
+        static auto install_signal_handlers() -> void;
+        static auto dump_all() -> void;
+
+      private:
+        [[nodiscard]] static auto now() -> uint64_t;
+
+        template<typename T>
+        static constexpr auto is_negative(const T& value) -> uint8_t {
+            if constexpr (std::is_signed<T>::value) {
+                return value < 0;
+            } else {
+                return 0;
+            }
+        }
+    };
+}
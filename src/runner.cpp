@@ -0,0 +1,316 @@
+#include "runner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "hybrid_transport.hpp"
+#include "local_transport.hpp"
+#include "logger.hpp"
+#include "overlay.hpp"
+#include "progress_transport.hpp"
+#include "simulation.hpp"
+#include "student.hpp"
+#include "winemaker.hpp"
+
+namespace nouveaux {
+
+    auto validate(const Config& config) -> bool {
+        auto valid = true;
+        Selector::Policy policy;
+        if (!Selector::policy_of(config.selection, policy)) {
+            fmt::print(stderr, "Unknown selection policy \"{}\", expected first, random, largest, least_recent or least_contended.\n", config.selection);
+            valid = false;
+        }
+        // Only the actor-per-rank MPI transport hosts the RMA window, others would silently keep stock in messages.
+        if (config.stock_table && (config.transport == "local" || config.transport == "hybrid" || config.transport == "simulation" || config.progress_thread)) {
+            fmt::print(stderr, "Stock table requires mpi transport without progress thread, got {} transport{}.\n", config.transport, config.progress_thread ? " with progress thread" : "");
+            valid = false;
+        }
+        return valid;
+    }
+
+    auto seed_of(const Config& config, uint32_t rank) -> uint64_t {
+        if (config.seed == 0 && config.transport != "simulation") {
+            return std::random_device()();
+        }
+        return config.seed + rank;
+    }
+
+    auto conclude(const Config& config, uint64_t processes, const Metrics& winemakers, const Metrics& students, double duration) -> void {
+        Metrics::summarize(winemakers, students, duration);
+        if (config.results.empty()) {
+            return;
+        }
+
+        auto file = std::fopen(config.results.c_str(), "a");
+        if (file == nullptr) {
+            fmt::print(stderr, "Cannot open results file {}.\n", config.results);
+            return;
+        }
+        std::fseek(file, 0, SEEK_END);
+        if (std::ftell(file) == 0) {
+            fmt::print(file, "transport,exclusion,processes,winemaker_count,student_count,safehouse_count,min_wine_volume,max_wine_volume,workload,broadcast_arity,seed,"
+                             "duration,produced,consumed,acquisitions,acquisitions_per_second,messages,messages_per_acquisition,"
+                             "winemaker_ack_wait_mean_ms,winemaker_ack_wait_p50_ms,winemaker_ack_wait_p99_ms,"
+                             "student_ack_wait_mean_ms,student_ack_wait_p50_ms,student_ack_wait_p99_ms\n");
+        }
+
+        const auto acquisitions = winemakers.ack_wait.count + students.ack_wait.count;
+        const auto messages = winemakers.messages() + students.messages();
+        fmt::print(file, "{},{},{},{},{},{},{},{},{},{},{},{:.6f},{},{},{},{:.1f},{},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f}\n",
+            config.transport,
+            config.exclusion,
+            processes,
+            config.winemaker_count,
+            config.student_count,
+            config.safehouse_count,
+            config.min_wine_volume,
+            config.max_wine_volume,
+            config.workload,
+            config.broadcast_arity,
+            config.seed,
+            duration,
+            winemakers.wine_volume,
+            students.wine_volume,
+            acquisitions,
+            duration > 0.0 ? acquisitions / duration : 0.0,
+            messages,
+            acquisitions > 0 ? static_cast<double>(messages) / acquisitions : 0.0,
+            winemakers.ack_wait.mean() * 1e-6,
+            winemakers.ack_wait.percentile(0.5) * 1e-6,
+            winemakers.ack_wait.percentile(0.99) * 1e-6,
+            students.ack_wait.mean() * 1e-6,
+            students.ack_wait.percentile(0.5) * 1e-6,
+            students.ack_wait.percentile(0.99) * 1e-6);
+        std::fclose(file);
+    }
+
+    auto open_event_log(const Config& config, uint64_t rank) -> std::unique_ptr<EventLog> {
+        if (config.event_log.empty()) {
+            return nullptr;
+        }
+        return std::make_unique<EventLog>(config.event_log, rank);
+    }
+
+    auto open_flight_recorder(const Config& config, uint64_t rank) -> std::unique_ptr<FlightRecorder> {
+        if (config.flight_recorder == 0) {
+            return nullptr;
+        }
+        return std::make_unique<FlightRecorder>(config.log_directory.c_str(), rank, config.flight_recorder);
+    }
+
+    auto workload_of(const Config& config, uint32_t rank) -> Workload::Settings {
+        const auto winemaker = static_cast<uint64_t>(rank) < config.winemaker_count;
+        return Workload::Settings {
+            /* .model = */ Workload::model_of(config.workload),
+            /* .min_volume = */ config.min_wine_volume,
+            /* .max_volume = */ config.max_wine_volume,
+            /* .shape = */ config.workload_shape,
+            /* .trace = */ config.workload_trace,
+            /* .service = */ Workload::service_of(config.service_time_model),
+            /* .service_time = */ winemaker ? config.production_time : config.consumption_time,
+        };
+    }
+
+    auto bounds_of(const Config& config, uint32_t rank) -> Termination::Bounds {
+        const auto share = std::max<uint64_t>(static_cast<uint64_t>(rank) < config.winemaker_count ? config.winemaker_count : config.student_count, 1);
+        return Termination::Bounds {
+            /* .rounds = */ config.rounds,
+            /* .wine_volume = */ (config.wine_volume + share - 1) / share,
+            /* .duration = */ config.duration,
+        };
+    }
+
+    auto spawn(const Config& config, uint32_t rank) -> void {
+        const auto bounds = bounds_of(config, rank);
+        std::unique_ptr<Termination> termination;
+        if (!bounds.unbounded()) {
+            termination = std::make_unique<Termination>(bounds, rank, config.winemaker_count + config.student_count);
+        }
+        Termination::bind(termination.get());
+        std::unique_ptr<Overlay> overlay;
+        if (config.broadcast_arity > 0) {
+            const Overlay::Group winemakers { 0, config.winemaker_count };
+            const Overlay::Group students { config.winemaker_count, config.student_count };
+            overlay = std::make_unique<Overlay>(config.broadcast_arity, rank, winemakers, students);
+        }
+        Overlay::bind(overlay.get());
+
+        const auto exclusion = Exclusion::mode_of(config.exclusion);
+        // Name was validated before any actor started.
+        auto selection = Selector::Policy::FIRST;
+        static_cast<void>(Selector::policy_of(config.selection, selection));
+        try {
+            if (static_cast<uint64_t>(rank) < config.winemaker_count) {
+                trace("Spawning winemaker #{}.", rank);
+                auto winemaker = Winemaker(config.safehouse_count, rank, config.winemaker_count, config.student_count, 0, config.winemaker_count, workload_of(config, rank), seed_of(config, rank), exclusion, config.leasing, config.lease_patience, config.pipelined);
+
+                if (rank == 0) {
+                    trace("Safehouse count: {}", config.safehouse_count);
+                    trace("Winemakers count: {}", config.winemaker_count);
+                    trace("Students count: {}", config.student_count);
+                }
+
+                winemaker.run();
+            } else {
+                trace("Spawning student #{}.", rank);
+                auto student = Student(config.safehouse_count, rank, config.winemaker_count, config.student_count, 0, config.winemaker_count, workload_of(config, rank), seed_of(config, rank), selection, exclusion, std::max<uint64_t>(config.batch_limit, 1));
+                student.run();
+            }
+        } catch (const Termination::Finished&) {
+            // Actor is gone, whatever is still addressed to it gets drained by the transport.
+        }
+        Overlay::bind(nullptr);
+        Termination::bind(nullptr);
+    }
+
+    auto spawn_with_progress(const Config& config, uint32_t rank, MpiTransport& transport) -> void {
+        ProgressTransport::Engine engine(transport);
+        auto& metrics = Metrics::current();
+        auto events = EventLog::current();
+        auto recorder = FlightRecorder::current();
+        std::atomic<bool> running(true);
+        std::thread actor([&] {
+            ProgressTransport endpoint(engine);
+            Transport::bind(endpoint);
+            Metrics::bind(metrics);
+            EventLog::bind(events);
+            FlightRecorder::bind(recorder);
+            spawn(config, rank);
+            running.store(false, std::memory_order_release);
+        });
+
+        // Answers go straight to MPI, counted apart from the actor's messages and merged once it stops.
+        // They're logged apart too, stamped by the clock shared with the actor they keep causal order.
+        Metrics progress {};
+        auto answers = events != nullptr ? std::make_unique<EventLog>(config.event_log, rank, ".progress") : nullptr;
+        Transport::bind(transport);
+        Metrics::bind(progress);
+        EventLog::bind(answers.get());
+        FlightRecorder::bind(nullptr);
+        engine.serve(running);
+        actor.join();
+
+        metrics.merge(progress);
+        Metrics::bind(metrics);
+        EventLog::bind(events);
+        FlightRecorder::bind(recorder);
+    }
+
+    auto run_local(const Config& config) -> Report {
+        Logger::init(0);
+
+        const auto size = config.winemaker_count + config.student_count;
+        LocalTransport::Network network(size);
+        // Metrics are large, keep them off the actors' stacks.
+        std::vector<Metrics> metrics(size, Metrics {});
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> actors;
+        actors.reserve(size);
+        for (uint64_t rank = 0; rank < size; ++rank) {
+            actors.emplace_back([&config, &network, &metrics, rank] {
+                LocalTransport transport(network, rank);
+                auto events = open_event_log(config, rank);
+                auto recorder = open_flight_recorder(config, rank);
+                Transport::bind(transport);
+                Metrics::bind(metrics[rank]);
+                EventLog::bind(events.get());
+                FlightRecorder::bind(recorder.get());
+                spawn(config, rank);
+            });
+        }
+
+        for (auto&& actor : actors) {
+            actor.join();
+        }
+
+        Report report {};
+        for (uint64_t rank = 0; rank < size; ++rank) {
+            (rank < config.winemaker_count ? report.winemakers : report.students).merge(metrics[rank]);
+        }
+        report.duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        return report;
+    }
+
+    auto run_hybrid(const Config& config, uint32_t rank, uint32_t size) -> Report {
+        const HybridTransport::Placement placement(config.winemaker_count + config.student_count, size, config.actors_per_rank);
+        HybridTransport::Node node(placement, rank);
+        const auto first = placement.first(rank);
+        const auto count = placement.count(rank);
+        // Metrics are large, keep them off the actors' stacks.
+        std::vector<Metrics> metrics(count, Metrics {});
+        const auto start = MPI_Wtime();
+        std::atomic<uint64_t> running(count);
+        std::vector<std::thread> actors;
+        actors.reserve(count);
+        for (uint64_t actor = 0; actor < count; ++actor) {
+            actors.emplace_back([&config, &node, &metrics, &running, first, actor] {
+                HybridTransport transport(node, first + actor);
+                auto events = open_event_log(config, first + actor);
+                auto recorder = open_flight_recorder(config, first + actor);
+                Transport::bind(transport);
+                Metrics::bind(metrics[actor]);
+                EventLog::bind(events.get());
+                FlightRecorder::bind(recorder.get());
+                spawn(config, first + actor);
+                running.fetch_sub(1, std::memory_order_release);
+            });
+        }
+
+        node.serve(running);
+        for (auto&& actor : actors) {
+            actor.join();
+        }
+        node.drain();
+
+        Report report {};
+        for (uint64_t actor = 0; actor < count; ++actor) {
+            (first + actor < config.winemaker_count ? report.winemakers : report.students).merge(metrics[actor]);
+        }
+        report.duration = MPI_Wtime() - start;
+
+        return report;
+    }
+
+    auto run_simulation(const Config& config) -> Report {
+        Logger::init(0);
+
+        const auto size = config.winemaker_count + config.student_count;
+        const Simulation::LatencyModel latency {
+            Simulation::LatencyModel::distribution_of(config.latency_model),
+            config.local_latency,
+            config.remote_latency,
+            config.actors_per_node,
+        };
+        Simulation simulation(size, latency, config.simulation_duration, config.seed);
+        // Metrics are large, keep them off the actors' stacks.
+        std::vector<Metrics> metrics(size, Metrics {});
+        simulation.run([&](uint64_t rank) {
+            Simulation::Endpoint endpoint(simulation, rank);
+            auto events = open_event_log(config, rank);
+            auto recorder = open_flight_recorder(config, rank);
+            Transport::bind(endpoint);
+            Metrics::bind(metrics[rank]);
+            EventLog::bind(events.get());
+            FlightRecorder::bind(recorder.get());
+            spawn(config, rank);
+        });
+
+        Report report {};
+        for (uint64_t rank = 0; rank < size; ++rank) {
+            (rank < config.winemaker_count ? report.winemakers : report.students).merge(metrics[rank]);
+        }
+        report.delivered = simulation.delivered();
+        report.duration = simulation.now();
+
+        return report;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "config.hpp"
+#include "event_log.hpp"
+#include "metrics.hpp"
+#include "mpi_transport.hpp"
+#include "recorder.hpp"
+#include "termination.hpp"
+#include "workload.hpp"
+
+namespace nouveaux {
+
+    // Outcome of the run within one process, metrics are merged per role.
+    struct Report {
+        Metrics winemakers;
+        Metrics students;
+        // Messages delivered during the whole run, simulation only.
+        uint64_t delivered;
+        // Seconds the run took, virtual ones when simulated.
+        double duration;
+    };
+
+    // Reports settings that can't work together or names nothing known to stderr, returns false if there was any.
+    [[nodiscard]] auto validate(const Config& config) -> bool;
+
+    // Seed of actor's random number generator.
+    [[nodiscard]] auto seed_of(const Config& config, uint32_t rank) -> uint64_t;
+
+    // Prints totals of a finished run and appends them to `config.results`, if set. Metrics are reduced already.
+    auto conclude(const Config& config, uint64_t processes, const Metrics& winemakers, const Metrics& students, double duration) -> void;
+
+    // Instruments enabled by configuration, nullptr when disabled.
+    [[nodiscard]] auto open_event_log(const Config& config, uint64_t rank) -> std::unique_ptr<EventLog>;
+    [[nodiscard]] auto open_flight_recorder(const Config& config, uint64_t rank) -> std::unique_ptr<FlightRecorder>;
+
+    // Workload of actor with given id (rank), winemakers take production time, students consumption time.
+    [[nodiscard]] auto workload_of(const Config& config, uint32_t rank) -> Workload::Settings;
+
+    // Bounds of actor with given id (rank), see `Termination`.
+    [[nodiscard]] auto bounds_of(const Config& config, uint32_t rank) -> Termination::Bounds;
+
+    // Runs actor with given id (rank) on the calling thread, transport and instruments have to be bound already.
+    // Returns once bounded run is over, never if it's unbounded.
+    auto spawn(const Config& config, uint32_t rank) -> void;
+    // Runs actor like `spawn` but on its own thread, calling thread serves as its progress thread (see `ProgressTransport`)
+    // until the actor stops. Instruments bound to calling thread are handed over to the actor.
+    auto spawn_with_progress(const Config& config, uint32_t rank, MpiTransport& transport) -> void;
+
+    // Every actor on its own thread, messages go through in-process mailboxes.
+    [[nodiscard]] auto run_local(const Config& config) -> Report;
+    // Actors placed on `rank` (out of `size`) on their own threads, calling thread serves as communication thread
+    // until all of them stop and nothing is left in flight. MPI has to be initialized already.
+    // Returns metrics of hosted actors.
+    [[nodiscard]] auto run_hybrid(const Config& config, uint32_t rank, uint32_t size) -> Report;
+    // Every actor on its own thread, driven one at a time by discrete-event engine in virtual time.
+    [[nodiscard]] auto run_simulation(const Config& config) -> Report;
+}
@@ -0,0 +1,251 @@
+#include "selection.hpp"
+
+#include <algorithm>
+
+namespace nouveaux {
+
+    SafehouseIndex::SafehouseIndex(uint64_t size)
+      : __words((size + 63) / 64, 0),
+        __summary((__words.size() + 63) / 64, 0),
+        __count(0) {}
+
+    auto SafehouseIndex::set(uint64_t index) -> void {
+        auto& word = __words[index / 64];
+        const auto bit = uint64_t(1) << (index % 64);
+        if (word & bit) {
+            return;
+        }
+
+        word |= bit;
+        __summary[index / 4096] |= uint64_t(1) << (index / 64 % 64);
+        ++__count;
+    }
+
+    auto SafehouseIndex::reset(uint64_t index) -> void {
+        auto& word = __words[index / 64];
+        const auto bit = uint64_t(1) << (index % 64);
+        if (!(word & bit)) {
+            return;
+        }
+
+        word &= ~bit;
+        if (word == 0) {
+            __summary[index / 4096] &= ~(uint64_t(1) << (index / 64 % 64));
+        }
+        --__count;
+    }
+
+    auto SafehouseIndex::next(uint64_t from) const -> uint64_t {
+        auto word = from / 64;
+        if (word >= __words.size()) {
+            return NONE;
+        }
+
+        // Rest of the word `from` falls into.
+        const auto rest = __words[word] & (~uint64_t(0) << (from % 64));
+        if (rest != 0) {
+            return word * 64 + __builtin_ctzll(rest);
+        }
+
+        // Following non-empty word, found through the summary.
+        ++word;
+        for (auto summary = word / 64; summary < __summary.size(); ++summary) {
+            auto bits = __summary[summary];
+            if (summary == word / 64) {
+                bits &= ~uint64_t(0) << (word % 64);
+            }
+            if (bits != 0) {
+                const auto found = summary * 64 + __builtin_ctzll(bits);
+                return found * 64 + __builtin_ctzll(__words[found]);
+            }
+        }
+        return NONE;
+    }
+
+    auto SafehouseIndex::nth(uint64_t rank) const -> uint64_t {
+        for (uint64_t word = 0; word < __words.size(); ++word) {
+            auto bits = __words[word];
+            const auto population = static_cast<uint64_t>(__builtin_popcountll(bits));
+            if (rank >= population) {
+                rank -= population;
+                continue;
+            }
+            for (; rank > 0; --rank) {
+                bits &= bits - 1;
+            }
+            return word * 64 + __builtin_ctzll(bits);
+        }
+        return NONE;
+    }
+
+    auto Selector::policy_of(const std::string& name, Policy& policy) -> bool {
+        if (name == "first")
+            policy = Policy::FIRST;
+        else if (name == "random")
+            policy = Policy::RANDOM;
+        else if (name == "largest")
+            policy = Policy::LARGEST;
+        else if (name == "least_recent")
+            policy = Policy::LEAST_RECENT;
+        else if (name == "least_contended")
+            policy = Policy::LEAST_CONTENDED;
+        else
+            return false;
+        return true;
+    }
+
+    Selector::Selector(const std::vector<uint64_t>& stock, Policy policy)
+      : __stock(stock),
+        __policy(policy),
+        __index(stock.size()),
+        __largest(),
+        __recent(),
+        __contended(),
+        __requested(stock.size(), 0),
+        __contention(stock.size(), 0) {
+        for (uint64_t safehouse = 0; safehouse < stock.size(); ++safehouse) {
+            update(safehouse);
+        }
+    }
+
+    auto Selector::update(uint64_t safehouse) -> void {
+        if (__stock[safehouse] == 0) {
+            hide(safehouse);
+        } else {
+            show(safehouse);
+        }
+    }
+
+    auto Selector::requested(uint64_t safehouse, uint64_t timestamp) -> void {
+        const auto later = timestamp > __requested[safehouse];
+        __requested[safehouse] = std::max(__requested[safehouse], timestamp);
+        recount(safehouse, __contention[safehouse], __contention[safehouse] + 1);
+        ++__contention[safehouse];
+        if (__policy == Policy::LEAST_RECENT && later && __index.test(safehouse)) {
+            push(__recent, safehouse, [&](uint64_t stocked) { return __requested[stocked]; });
+        }
+    }
+
+    auto Selector::released(uint64_t safehouse) -> void {
+        if (__contention[safehouse] > 0) {
+            recount(safehouse, __contention[safehouse], __contention[safehouse] - 1);
+            --__contention[safehouse];
+        }
+    }
+
+    auto Selector::select(std::mt19937& rng) -> uint64_t {
+        if (__index.empty()) {
+            return SafehouseIndex::NONE;
+        }
+
+        switch (__policy) {
+            case Policy::RANDOM:
+                return __index.nth(std::uniform_int_distribution<uint64_t>(0, __index.count() - 1)(rng));
+            case Policy::LARGEST:
+                return top(__largest, [&](uint64_t safehouse) { return __stock[safehouse]; });
+            case Policy::LEAST_RECENT:
+                return top(__recent, [&](uint64_t safehouse) { return __requested[safehouse]; });
+            case Policy::LEAST_CONTENDED:
+                // Lowest non-empty level, ties broken uniformly at random.
+                for (auto&& level : __contended) {
+                    if (!level.empty()) {
+                        return level.nth(std::uniform_int_distribution<uint64_t>(0, level.count() - 1)(rng));
+                    }
+                }
+                return __index.first();
+            case Policy::FIRST:
+            default:
+                return __index.first();
+        }
+    }
+
+    auto Selector::select(std::mt19937& rng, uint64_t demand, uint64_t limit) -> std::vector<uint64_t> {
+        std::vector<uint64_t> batch;
+        uint64_t covered = 0;
+        while (covered < demand && batch.size() < limit) {
+            const auto safehouse = select(rng);
+            if (safehouse == SafehouseIndex::NONE) {
+                break;
+            }
+            batch.push_back(safehouse);
+            covered += __stock[safehouse];
+            // Hidden from following picks until the batch is complete.
+            hide(safehouse);
+        }
+
+        for (auto&& safehouse : batch) {
+            update(safehouse);
+        }
+        std::sort(batch.begin(), batch.end());
+        batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+        return batch;
+    }
+
+    auto Selector::show(uint64_t safehouse) -> void {
+        const auto visible = __index.test(safehouse);
+        __index.set(safehouse);
+        switch (__policy) {
+            case Policy::LARGEST:
+                push(__largest, safehouse, [&](uint64_t stocked) { return __stock[stocked]; });
+                break;
+            case Policy::LEAST_RECENT:
+                if (!visible) {
+                    push(__recent, safehouse, [&](uint64_t stocked) { return __requested[stocked]; });
+                }
+                break;
+            case Policy::LEAST_CONTENDED:
+                contended(__contention[safehouse]).set(safehouse);
+                break;
+            default:
+                break;
+        }
+    }
+
+    auto Selector::hide(uint64_t safehouse) -> void {
+        __index.reset(safehouse);
+        if (__policy == Policy::LEAST_CONTENDED) {
+            contended(__contention[safehouse]).reset(safehouse);
+        }
+    }
+
+    auto Selector::recount(uint64_t safehouse, uint64_t from, uint64_t to) -> void {
+        if (__policy != Policy::LEAST_CONTENDED || !__index.test(safehouse)) {
+            return;
+        }
+        contended(from).reset(safehouse);
+        contended(to).set(safehouse);
+    }
+
+    auto Selector::contended(uint64_t contention) -> SafehouseIndex& {
+        while (__contended.size() <= contention) {
+            __contended.emplace_back(__stock.size());
+        }
+        return __contended[contention];
+    }
+
+    template<typename Heap, typename Key>
+    auto Selector::push(Heap& heap, uint64_t safehouse, Key key) -> void {
+        // Stale entries sink below fresh ones only until they reach the top, rebuild before they pile up.
+        if (heap.size() >= 4 * __stock.size()) {
+            heap = {};
+            for (auto stocked = __index.first(); stocked != SafehouseIndex::NONE; stocked = __index.next(stocked + 1)) {
+                heap.emplace(key(stocked), stocked);
+            }
+        } else {
+            heap.emplace(key(safehouse), safehouse);
+        }
+    }
+
+    template<typename Heap, typename Key>
+    auto Selector::top(Heap& heap, Key key) -> uint64_t {
+        while (!heap.empty()) {
+            const auto [value, safehouse] = heap.top();
+            // Safehouses already picked into the batch are hidden from the index, their entries are stale too.
+            if (__index.test(safehouse) && key(safehouse) == value) {
+                return safehouse;
+            }
+            heap.pop();
+        }
+        return __index.first();
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nouveaux {
+
+    // Set of non-empty safehouses as a two level bitset.
+    //
+    // Every bit of `__summary` tells whether corresponding word of `__words` has any bit set,
+    // so finding first (or next) non-empty safehouse skips 4096 empty safehouses per summary word.
+    class SafehouseIndex {
+        std::vector<uint64_t> __words;
+        std::vector<uint64_t> __summary;
+        uint64_t __count;
+
+      public:
+        static constexpr uint64_t NONE = UINT64_MAX;
+
+        explicit SafehouseIndex(uint64_t size);
+
+        auto set(uint64_t index) -> void;
+        auto reset(uint64_t index) -> void;
+        [[nodiscard]] auto test(uint64_t index) const -> bool { return __words[index / 64] >> (index % 64) & 1; }
+        [[nodiscard]] auto count() const -> uint64_t { return __count; }
+        [[nodiscard]] auto empty() const -> bool { return __count == 0; }
+
+        // First set index not lower than `from`, NONE if there is none.
+        [[nodiscard]] auto next(uint64_t from) const -> uint64_t;
+        [[nodiscard]] auto first() const -> uint64_t { return next(0); }
+        // Set index with `rank` set indices before it, `rank` must be lower than `count()`.
+        [[nodiscard]] auto nth(uint64_t rank) const -> uint64_t;
+    };
+
+    // Chooses safehouse student tries to acquire next.
+    //
+    // Reads stock from the student's own view of safehouses, which has to be reported with `update`
+    // on every change. Incoming requests and releases feed contention based policies.
+    class Selector {
+      public:
+        enum class Policy {
+            // Lowest index, every student competes for the same safehouse.
+            FIRST,
+            // Uniformly random non-empty safehouse.
+            RANDOM,
+            // Safehouse with most wine.
+            LARGEST,
+            // Safehouse whose latest seen request is the oldest.
+            LEAST_RECENT,
+            // Safehouse with fewest requests seen in progress, ties broken randomly.
+            LEAST_CONTENDED,
+        };
+
+        // Stores policy called `name` in `policy`, returns false (leaving it alone) for unknown names.
+        [[nodiscard]] static auto policy_of(const std::string& name, Policy& policy) -> bool;
+
+      private:
+        const std::vector<uint64_t>& __stock;
+        const Policy __policy;
+        SafehouseIndex __index;
+        // Lazily cleaned max-heap of (stock, safehouse), entries not matching `__stock` or `__index` are stale.
+        std::priority_queue<std::pair<uint64_t, uint64_t>> __largest;
+        // Lazily cleaned min-heap of (latest request, safehouse), entries not matching `__requested` or `__index` are stale.
+        std::priority_queue<std::pair<uint64_t, uint64_t>, std::vector<std::pair<uint64_t, uint64_t>>, std::greater<>> __recent;
+        // Safehouses of `__index` split by their contention, grows with the highest contention seen.
+        std::vector<SafehouseIndex> __contended;
+        // Lamport timestamp of the latest request seen per safehouse.
+        std::vector<uint64_t> __requested;
+        // Requests seen but not yet released per safehouse.
+        std::vector<uint64_t> __contention;
+
+      public:
+        Selector(const std::vector<uint64_t>& stock, Policy policy);
+
+        // Stock of `safehouse` has changed.
+        auto update(uint64_t safehouse) -> void;
+        auto requested(uint64_t safehouse, uint64_t timestamp) -> void;
+        auto released(uint64_t safehouse) -> void;
+
+        // Non-empty safehouse according to policy, `SafehouseIndex::NONE` if all are empty.
+        [[nodiscard]] auto select(std::mt19937& rng) -> uint64_t;
+        // Non-empty safehouses picked one by one according to policy until their stock covers `demand`
+        // or there are `limit` of them, ascending and without duplicates. Empty if all safehouses are empty.
+        [[nodiscard]] auto select(std::mt19937& rng, uint64_t demand, uint64_t limit) -> std::vector<uint64_t>;
+
+      private:
+        // Adds `safehouse` to (or removes it from) the index together with the structures of the policy.
+        auto show(uint64_t safehouse) -> void;
+        auto hide(uint64_t safehouse) -> void;
+        // Contention of visible `safehouse` changes from `from` to `to`.
+        auto recount(uint64_t safehouse, uint64_t from, uint64_t to) -> void;
+        [[nodiscard]] auto contended(uint64_t contention) -> SafehouseIndex&;
+        template<typename Heap, typename Key>
+        auto push(Heap& heap, uint64_t safehouse, Key key) -> void;
+        // Top of the heap skipping stale entries, the first visible safehouse once it runs out.
+        template<typename Heap, typename Key>
+        [[nodiscard]] auto top(Heap& heap, Key key) -> uint64_t;
+    };
+}
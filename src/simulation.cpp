@@ -0,0 +1,189 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+
+namespace nouveaux {
+
+    auto Simulation::LatencyModel::sample(uint64_t sender, uint64_t receiver, std::mt19937_64& rng) const -> double {
+        const auto node = std::max<uint64_t>(actors_per_node, 1);
+        const auto mean = sender / node == receiver / node ? local : remote;
+        switch (distribution) {
+            case Distribution::UNIFORM:
+                return std::uniform_real_distribution<double>(0.0, 2.0 * mean)(rng);
+            case Distribution::EXPONENTIAL:
+                return mean > 0.0 ? std::exponential_distribution<double>(1.0 / mean)(rng) : 0.0;
+            case Distribution::CONSTANT:
+            default:
+                return mean;
+        }
+    }
+
+    auto Simulation::LatencyModel::distribution_of(const std::string& name) -> Distribution {
+        if (name == "uniform")
+            return Distribution::UNIFORM;
+        if (name == "exponential")
+            return Distribution::EXPONENTIAL;
+        return Distribution::CONSTANT;
+    }
+
+    Simulation::Simulation(uint64_t size, LatencyModel latency, double duration, uint64_t seed)
+      : __latency(latency),
+        __duration(duration),
+        __rng(seed),
+        __actors(new Actor[size]),
+        __size(size),
+        __events(),
+        __links({}),
+        __now(0.0),
+        __sequence(0),
+        __over(false),
+        __delivered(0) {
+        for (uint64_t id = 0; id < size; ++id) {
+            __actors[id].running = false;
+            __actors[id].finished = false;
+        }
+    }
+
+    auto Simulation::run(const std::function<void(uint64_t)>& actor) -> void {
+        for (uint64_t id = 0; id < __size; ++id) {
+            __actors[id].thread = std::thread([this, &actor, id] {
+                auto& self = __actors[id];
+                {
+                    std::unique_lock<std::mutex> lock(__mutex);
+                    self.wakeup.wait(lock, [&] { return self.running; });
+                }
+
+                try {
+                    actor(id);
+                } catch (const Shutdown&) {
+                }
+
+                std::lock_guard<std::mutex> lock(__mutex);
+                self.running = false;
+                self.finished = true;
+                __yielded.notify_one();
+            });
+        }
+
+        // Every actor runs until it waits for its first message.
+        for (uint64_t id = 0; id < __size; ++id) {
+            resume(id);
+        }
+
+        while (!__events.empty()) {
+            auto event = __events.top();
+            if (event.time > __duration) {
+                __now = __duration;
+                break;
+            }
+            __events.pop();
+
+            __now = event.time;
+            if (event.message.type != Message::Type::UNKNOWN) {
+                ++__delivered;
+            }
+            if (!__actors[event.receiver].finished) {
+                __actors[event.receiver].inbox.push_back(event.message);
+                resume(event.receiver);
+            }
+        }
+
+        __over = true;
+        for (uint64_t id = 0; id < __size; ++id) {
+            if (!__actors[id].finished) {
+                resume(id);
+            }
+            __actors[id].thread.join();
+        }
+    }
+
+    auto Simulation::schedule(const Message& message, uint64_t receiver) -> void {
+        auto& latest = __links[message.sender * __size + receiver];
+        latest = std::max(__now + __latency.sample(message.sender, receiver, __rng), latest);
+        __events.push(Event { latest, __sequence++, receiver, message });
+    }
+
+    auto Simulation::wake(uint64_t id, double delay) -> void {
+        const Message wakeup {
+            /* .type = */ Message::Type::UNKNOWN,
+            /* .sender = */ id,
+            /* .timestamp = */ 0,
+            /* .payload = */ Message::Payload {},
+        };
+        __events.push(Event { __now + delay, __sequence++, id, wakeup });
+    }
+
+    auto Simulation::await(uint64_t id) -> Message {
+        auto& self = __actors[id];
+        while (self.inbox.empty()) {
+            if (__over) {
+                throw Shutdown {};
+            }
+
+            std::unique_lock<std::mutex> lock(__mutex);
+            self.running = false;
+            __yielded.notify_one();
+            self.wakeup.wait(lock, [&] { return self.running; });
+        }
+
+        auto message = self.inbox.front();
+        self.inbox.pop_front();
+        return message;
+    }
+
+    auto Simulation::resume(uint64_t id) -> void {
+        auto& actor = __actors[id];
+        std::unique_lock<std::mutex> lock(__mutex);
+        actor.running = true;
+        actor.wakeup.notify_one();
+        __yielded.wait(lock, [&] { return !actor.running; });
+    }
+
+    auto Simulation::Endpoint::send(const Message& message, uint64_t receiver) -> void {
+        __simulation.schedule(message, receiver);
+    }
+
+    auto Simulation::Endpoint::send(const Message& message, Fanout& fanout) -> void {
+        for (auto&& receiver : fanout.receivers()) {
+            __simulation.schedule(message, receiver);
+        }
+    }
+
+    auto Simulation::Endpoint::receive(int source) -> Message {
+        auto deferred = std::find_if(__deferred.begin(), __deferred.end(), [&](auto&& message) {
+            return source == ANY_SOURCE || message.sender == static_cast<uint64_t>(source);
+        });
+        if (deferred != __deferred.end()) {
+            auto message = *deferred;
+            __deferred.erase(deferred);
+            return message;
+        }
+
+        while (true) {
+            auto message = __simulation.await(__id);
+            if (source == ANY_SOURCE || message.sender == static_cast<uint64_t>(source)) {
+                return message;
+            }
+            __deferred.push_back(message);
+        }
+    }
+
+    auto Simulation::Endpoint::now() const -> double {
+        return __simulation.now();
+    }
+
+    auto Simulation::Endpoint::wake_at(double time) -> void {
+        __simulation.wake(__id, std::max(time - __simulation.now(), 0.0));
+    }
+
+    auto Simulation::Endpoint::pause(double seconds) -> void {
+        __simulation.wake(__id, seconds);
+        while (true) {
+            auto message = __simulation.await(__id);
+            if (message.type == Message::Type::UNKNOWN && message.sender == __id) {
+                return;
+            }
+            __deferred.push_back(message);
+        }
+    }
+}
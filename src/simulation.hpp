@@ -0,0 +1,137 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "message.hpp"
+#include "transport.hpp"
+
+namespace nouveaux {
+
+    // Deterministic discrete-event simulation of all actors in a single process.
+    //
+    // Every actor runs its unmodified `run()` on its own thread, but only one thread runs at a time:
+    // engine hands control to the receiver of the earliest message in flight and waits until it blocks
+    // in `receive` again. Computation takes no virtual time, only message delivery does.
+    // With the same seed every run delivers the same messages in the same order.
+    class Simulation {
+      public:
+        // Thrown from `receive` once simulation is over, unwinds actor's `run()`.
+        struct Shutdown {};
+
+        // Delay of messages between two actors.
+        //
+        // Actors are packed onto nodes of `actors_per_node` consecutive ids, links within one node
+        // have `local` mean latency, links between nodes `remote` one (both in virtual seconds).
+        struct LatencyModel {
+            enum class Distribution {
+                CONSTANT,
+                UNIFORM,
+                EXPONENTIAL,
+            };
+
+            Distribution distribution;
+            double local;
+            double remote;
+            uint64_t actors_per_node;
+
+            [[nodiscard]] auto sample(uint64_t sender, uint64_t receiver, std::mt19937_64& rng) const -> double;
+            // Unknown names fall back to constant latency.
+            [[nodiscard]] static auto distribution_of(const std::string& name) -> Distribution;
+        };
+
+        // Transport endpoint of single simulated actor.
+        class Endpoint : public Transport {
+            Simulation& __simulation;
+            const uint64_t __id;
+            // Messages delivered while waiting for specific sender.
+            std::deque<Message> __deferred;
+
+          public:
+            Endpoint(Simulation& simulation, uint64_t id)
+              : __simulation(simulation),
+                __id(id),
+                __deferred({}) {}
+
+            auto send(const Message& message, uint64_t receiver) -> void override;
+            auto send(const Message& message, Fanout& fanout) -> void override;
+            [[nodiscard]] auto receive(int source) -> Message override;
+            [[nodiscard]] auto now() const -> double override;
+            // Sleeps until wake-up scheduled `seconds` ahead, messages delivered meanwhile are deferred.
+            auto pause(double seconds) -> void override;
+            // Wake-up due while paused ends the pause, the pause's own one is then received instead.
+            auto wake_at(double time) -> void override;
+        };
+
+      private:
+        struct Event {
+            double time;
+            // Breaks ties between messages delivered at the same time, keeps order deterministic.
+            uint64_t sequence;
+            uint64_t receiver;
+            Message message;
+        };
+
+        struct Later {
+            auto operator()(const Event& lhs, const Event& rhs) const -> bool {
+                return lhs.time > rhs.time || (lhs.time == rhs.time && lhs.sequence > rhs.sequence);
+            }
+        };
+
+        struct Actor {
+            std::thread thread;
+            std::condition_variable wakeup;
+            // Whether actor holds control, guarded by `__mutex`.
+            bool running;
+            bool finished;
+            // Delivered messages not yet received.
+            std::deque<Message> inbox;
+        };
+
+        const LatencyModel __latency;
+        const double __duration;
+        std::mt19937_64 __rng;
+        std::unique_ptr<Actor[]> __actors;
+        const uint64_t __size;
+        std::priority_queue<Event, std::vector<Event>, Later> __events;
+        // Latest delivery time per link (`sender * size + receiver`), links stay FIFO like MPI.
+        std::unordered_map<uint64_t, double> __links;
+        double __now;
+        uint64_t __sequence;
+        bool __over;
+        uint64_t __delivered;
+
+        std::mutex __mutex;
+        std::condition_variable __yielded;
+
+      public:
+        Simulation(uint64_t size, LatencyModel latency, double duration, uint64_t seed);
+        Simulation(const Simulation&) = delete;
+        auto operator=(const Simulation&) -> Simulation& = delete;
+
+        // Runs `actor(id)` for every actor id until virtual time passes duration or no message is in flight.
+        auto run(const std::function<void(uint64_t)>& actor) -> void;
+
+        [[nodiscard]] auto now() const -> double { return __now; }
+        [[nodiscard]] auto delivered() const -> uint64_t { return __delivered; }
+
+      private:
+        auto schedule(const Message& message, uint64_t receiver) -> void;
+        // Delivers wake-up (UNKNOWN message from actor to itself) to `id` after `delay`, off any link.
+        auto wake(uint64_t id, double delay) -> void;
+        // Called on actor's thread, gives control back to engine until a message arrives.
+        auto await(uint64_t id) -> Message;
+        // Called on engine thread, gives control to actor until it awaits again or finishes.
+        auto resume(uint64_t id) -> void;
+    };
+}
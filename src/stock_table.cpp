@@ -0,0 +1,80 @@
+#include "stock_table.hpp"
+
+#include <algorithm>
+
+namespace nouveaux {
+
+    namespace {
+        thread_local StockTable* __current = nullptr;
+
+        constexpr int HOST = 0;
+    }
+
+    StockTable::StockTable(uint64_t safehouse_count)
+      : __window(MPI_WIN_NULL),
+        __size(safehouse_count),
+        __buffer(safehouse_count, 0) {
+        int rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+        int64_t* base = nullptr;
+        const auto bytes = rank == HOST ? static_cast<MPI_Aint>(safehouse_count * sizeof(int64_t)) : 0;
+        MPI_Win_allocate(bytes, sizeof(int64_t), MPI_INFO_NULL, MPI_COMM_WORLD, &base, &__window);
+        if (rank == HOST) {
+            std::fill(base, base + safehouse_count, 0);
+        }
+        // Nobody touches the table before it's zeroed.
+        MPI_Barrier(MPI_COMM_WORLD);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, __window);
+    }
+
+    StockTable::~StockTable() {
+        MPI_Win_unlock_all(__window);
+        MPI_Win_free(&__window);
+    }
+
+    auto StockTable::read(std::vector<uint64_t>& stock) -> void {
+        MPI_Get_accumulate(nullptr, 0, MPI_INT64_T, __buffer.data(), __size, MPI_INT64_T, HOST, 0, __size, MPI_INT64_T, MPI_NO_OP, __window);
+        MPI_Win_flush(HOST, __window);
+        for (uint64_t safehouse = 0; safehouse < __size; ++safehouse) {
+            stock[safehouse] = static_cast<uint64_t>(std::max<int64_t>(__buffer[safehouse], 0));
+        }
+    }
+
+    auto StockTable::read(uint64_t safehouse) -> uint64_t {
+        int64_t stock = 0;
+        MPI_Fetch_and_op(nullptr, &stock, MPI_INT64_T, HOST, safehouse, MPI_NO_OP, __window);
+        MPI_Win_flush(HOST, __window);
+        return static_cast<uint64_t>(std::max<int64_t>(stock, 0));
+    }
+
+    auto StockTable::deposit(uint64_t safehouse, uint64_t volume) -> void {
+        const auto delta = static_cast<int64_t>(volume);
+        MPI_Accumulate(&delta, 1, MPI_INT64_T, HOST, safehouse, 1, MPI_INT64_T, MPI_SUM, __window);
+        MPI_Win_flush(HOST, __window);
+    }
+
+    auto StockTable::consume(uint64_t safehouse, uint64_t demand) -> Consumption {
+        const auto want = static_cast<int64_t>(demand);
+        const auto delta = -want;
+        int64_t stock = 0;
+        MPI_Fetch_and_op(&delta, &stock, MPI_INT64_T, HOST, safehouse, MPI_SUM, __window);
+        MPI_Win_flush(HOST, __window);
+
+        const auto volume = std::clamp<int64_t>(stock, 0, want);
+        if (volume < want) {
+            const auto rest = want - volume;
+            MPI_Accumulate(&rest, 1, MPI_INT64_T, HOST, safehouse, 1, MPI_INT64_T, MPI_SUM, __window);
+            MPI_Win_flush(HOST, __window);
+        }
+        return { static_cast<uint64_t>(volume), volume > 0 && stock <= want };
+    }
+
+    auto StockTable::bind(StockTable* table) -> void {
+        __current = table;
+    }
+
+    auto StockTable::current() -> StockTable* {
+        return __current;
+    }
+}
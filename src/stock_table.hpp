@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <mpi.h>
+
+namespace nouveaux {
+
+    // Authoritative stock of every safehouse in an MPI RMA window hosted by rank 0.
+    //
+    // Replaces supply broadcasts and students' REQ/ACK rounds: winemakers deposit and students consume
+    // with passive-target atomics, so nobody has to take part in accesses of others. Every access is an
+    // accumulate-family operation with MPI_SUM or MPI_NO_OP, which the default `accumulate_ops`
+    // (same_op_no_op) makes atomic per element.
+    //
+    // Consumption subtracts the whole demand at once and gives back what the stock couldn't cover.
+    // Value seen by anyone then never exceeds what is really left, so nobody takes more than there is.
+    class StockTable {
+        MPI_Win __window;
+        const uint64_t __size;
+        std::vector<int64_t> __buffer;
+
+      public:
+        struct Consumption {
+            uint64_t volume;
+            // Whether this consumption took the last unit.
+            bool emptied;
+        };
+
+        // Collective over MPI_COMM_WORLD.
+        explicit StockTable(uint64_t safehouse_count);
+        StockTable(const StockTable&) = delete;
+        auto operator=(const StockTable&) -> StockTable& = delete;
+        // Collective over MPI_COMM_WORLD.
+        ~StockTable();
+
+        // Current stock of every safehouse.
+        auto read(std::vector<uint64_t>& stock) -> void;
+        [[nodiscard]] auto read(uint64_t safehouse) -> uint64_t;
+        auto deposit(uint64_t safehouse, uint64_t volume) -> void;
+        // Takes at most `demand` units.
+        [[nodiscard]] auto consume(uint64_t safehouse, uint64_t demand) -> Consumption;
+
+        // Makes `table` the one used by actor on calling thread, `nullptr` keeps stock in messages.
+        static auto bind(StockTable* table) -> void;
+        [[nodiscard]] static auto current() -> StockTable*;
+    };
+}
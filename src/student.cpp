@@ -1,162 +1,258 @@
 #include "student.hpp"
 
 #include <algorithm>
+#include <thread>
 
 #include "logger.hpp"
+#include "manager_exclusion.hpp"
+#include "metrics.hpp"
 #include "message.hpp"
+#include "overlay.hpp"
+#include "quorum_exclusion.hpp"
+#include "stock_table.hpp"
 #include "tags.hpp"
+#include "termination.hpp"
+#include "token_exclusion.hpp"
 
-#define format(fmt) "[{:0>10}] STUDENT #{} " fmt, __timestamp, __rank
+#define format(fmt) "[{:0>10}] STUDENT #{} " fmt, __timestamp.load(std::memory_order_relaxed), __rank
 
 namespace nouveaux {
-    Student::Student(uint64_t safehouse_count, uint32_t rank, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count, uint32_t min_wine_volume, uint32_t max_wine_volume)
-      : __rng(std::random_device()()),
-        __dist(min_wine_volume, max_wine_volume),
+    namespace {
+        auto range_of(uint64_t start_id, uint64_t count) -> std::vector<uint64_t> {
+            std::vector<uint64_t> range;
+            for (auto id = start_id; id < start_id + count; ++id) {
+                range.push_back(id);
+            }
+            return range;
+        }
+
+        auto exclusion_of(Exclusion::Mode mode, std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count) -> std::unique_ptr<Exclusion> {
+            if (mode == Exclusion::Mode::TOKEN) {
+                return std::make_unique<TokenExclusion>(clock, rank, safehouse_count, students_start_id, winemakers_start_id, winemakers_count);
+            }
+            if (mode == Exclusion::Mode::MANAGER) {
+                return std::make_unique<ManagerExclusion>(clock, rank, safehouse_count, students_start_id, winemakers_start_id, winemakers_count);
+            }
+            return std::make_unique<QuorumExclusion>(clock, rank, safehouse_count, students_start_id, students_count);
+        }
+    }
+
+    Student::Student(uint64_t safehouse_count, uint32_t rank, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count, const Workload::Settings& workload, uint64_t seed, Selector::Policy selection, Exclusion::Mode exclusion, uint64_t batch_limit)
+      : __rng(seed),
+        __workload(workload, rank),
         __demand(0),
-        __safehouses({}),
+        __safehouses(safehouse_count, 0),
+        __known_at(safehouse_count, 0),
+        __selector(__safehouses, selection),
         __timestamp(0),
-        __priority(0),
-        __safehouse(0),
-        __ack_counter(0),
-        __pending_acks({}),
+        __batch({}),
+        __batch_limit(batch_limit),
+        __exclusion(exclusion_of(exclusion, __timestamp, rank, safehouse_count, students_start_id, students_count, winemakers_start_id, winemakers_count)),
+        __table(StockTable::current()),
         __students_start_id(students_start_id),
         __students_count(students_count),
         __winemakers_start_id(winemakers_start_id),
         __winemakers_count(winemakers_count),
-        __rank(rank) {
-        __safehouses.reserve(safehouse_count);
-        for (uint64_t i = 0; i < safehouse_count; ++i)
-            __safehouses.push_back(0);
-    }
+        __rank(rank),
+        __broadcast_fanout(range_of(winemakers_start_id, winemakers_count)) {}
 
     auto Student::run() -> void {
         trace(format("STARTING."));
-        bool skip_safehouse = false;
-        // Run infinitely
+        if (__table != nullptr) {
+            run_on_table();
+            return;
+        }
+
+        // Acquisition is abandoned once all chosen safehouses turn out to be empty.
+        const auto observer = [this](const Message& message) {
+            observe(message);
+            return std::all_of(__batch.begin(), __batch.end(), [this](auto&& safehouse) { return __safehouses[safehouse] == 0; });
+        };
+        // Run until bounded run is over, infinitely if unbounded.
         while (true) {
-            __demand = __dist(__rng);
+            __demand = __workload.volume(__rng);
             debug(format("DEMAND: {}"), __demand);
 
             while (__demand != 0) {
-                // Find non-empty safehouse
-                __safehouse = std::numeric_limits<uint64_t>::max();
-                auto index = 0;
-                for (auto&& safehouse : __safehouses) {
-                    if (safehouse > 0) {
-                        __safehouse = index;
-                        break;
+                // Find non-empty safehouses, as many as it takes to cover the demand.
+                __batch = __selector.select(__rng, __demand, __batch_limit);
+
+                while (__batch.empty()) {
+                    trace(format("ALL SAFEHOUSES EMPTY."));
+                    auto message = __exclusion->receive();
+                    __exclusion->handle(message);
+                    observe(message);
+                    if (message.type == Message::Type::WINEMAKER_BROADCAST && __safehouses[message.payload.safehouse_index] > 0) {
+                        __batch.push_back(message.payload.safehouse_index);
                     }
-                    ++index;
                 }
 
-                while (__safehouse == std::numeric_limits<uint64_t>::max()) {
-                    trace(format("ALL SAFEHOUSES EMPTY."));
-                    auto message = Message::receive_from(ANY_SOURCE);
-                    __timestamp = std::max(__timestamp, message.timestamp) + 1;
-                    if (message.type == Message::Type::WINEMAKER_BROADCAST) {
-                        debug(format("received WINEMAKER BROADCAST {{ timestamp: {}, sender: {}, safehouse: {}, volume: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.wine_volume);
-                        __safehouses[message.payload.safehouse_index] = message.payload.wine_volume;
-                        __safehouse = message.payload.safehouse_index;
-                    } else if (message.type == Message::Type::STUDENT_REQUEST) {
-                        debug(format("received STUDENT REQUEST {{ timestamp: {}, sender: {}, safehouse: {}, volume: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.wine_volume);
-                        send_ack(message);
+                trace(format("CHOSEN SAFEHOUSE: {} (batch of {})"), __batch.front(), __batch.size());
+                Metrics::current().batch.record(__batch.size());
+                const auto requested_at = Transport::current().now();
+                auto consumed = false;
+                // Safehouses are entered one at a time in order their permissions come in.
+                const auto consume = [&](uint64_t safehouse) {
+                    // Stock carried by the protocol is exact, the local view may be outdated.
+                    if (const auto stock = __exclusion->stock(); stock != nullptr) {
+                        __safehouses[safehouse] = *stock;
+                        __known_at[safehouse] = __timestamp;
+                        __selector.update(safehouse);
+                    }
+                    if (__safehouses[safehouse] == 0) {
+                        return true;
+                    }
+
+                    const auto entered_at = Transport::current().now();
+                    Metrics::current().ack_wait.record(nanoseconds(requested_at, entered_at));
+
+                    ++__timestamp;
+                    trace(format("safehouse acquire state {{ remaining demand: {}, safehouse #{} supplies: {} }}"), __demand, safehouse, __safehouses[safehouse]);
+                    const auto volume = std::min(static_cast<uint64_t>(__demand), __safehouses[safehouse]);
+                    if (const auto service_time = __workload.service_time(__rng); service_time > 0.0) {
+                        Transport::current().pause(service_time);
+                    }
+                    __safehouses[safehouse] -= volume;
+                    __known_at[safehouse] = __timestamp;
+                    if (const auto stock = __exclusion->stock(); stock != nullptr) {
+                        *stock -= volume;
+                    }
+                    __exclusion->report(__safehouses[safehouse]);
+                    __selector.update(safehouse);
+                    __demand -= volume;
+                    Metrics::current().wine_volume += volume;
+                    if (auto termination = Termination::current()) {
+                        termination->record(volume);
+                    }
+                    consumed = true;
+                    trace(format("safehouse release state {{ remaining demand: {}, safehouse #{} supplies: {} }}"), __demand, safehouse, __safehouses[safehouse]);
+
+                    if (__safehouses[safehouse] == 0) {
+                        send_broadcast(safehouse);
+                    }
+
+                    Metrics::current().hold.record(nanoseconds(entered_at, Transport::current().now()));
+                    return __demand != 0;
+                };
+
+                __exclusion->acquire_batch(__batch, observer, consume);
+                if (!consumed) {
+                    ++Metrics::current().skips;
+                    if (auto termination = Termination::current()) {
+                        termination->record(0);
                     }
                 }
+            }
+        }
+    }
 
-                trace(format("CHOSEN SAFEHOUSE: {}"), __safehouse);
-                send_req();
-
-                while (__ack_counter < __students_count - 1) {
-                    auto message = Message::receive_from(ANY_SOURCE);
-                    __timestamp = std::max(__timestamp, message.timestamp) + 1;
-                    if (message.type == Message::Type::STUDENT_ACKNOWLEDGE && message.payload.last_timestamp == __priority) {
-                        debug(format("received STUDENT ACKNOWLEDGE {{ timestamp: {}, sender: {}, safehouse: {}, request timestamp: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.last_timestamp);
-                        ++__ack_counter;
-                    } else if (message.type == Message::Type::STUDENT_REQUEST) {
-                        debug(format("received STUDENT REQUEST {{ timestamp: {}, sender: {}, safehouse: {}, volume: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.wine_volume);
-                        if (message.payload.safehouse_index != __safehouse) {
-                            send_ack(message);
-                        } else if (message.timestamp < __priority || (message.timestamp == __priority && message.sender < __rank)) {
-                            send_ack(message);
-                        } else if (message.timestamp > __priority || (message.timestamp == __priority && message.sender > __rank)) {
-                            __pending_acks.emplace_back(message);
-                            ++__ack_counter;
-                        }
-                        if (__safehouses[__safehouse] == 0) {
-                            skip_safehouse = true;
-                            break;
-                        }
-                    } else if (message.type == Message::Type::WINEMAKER_BROADCAST) {
-                        debug(format("received WINEMAKER BROADCAST {{ timestamp: {}, sender: {}, safehouse: {}, volume: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.wine_volume);
-                        __safehouses[message.payload.safehouse_index] = message.payload.wine_volume;
+    auto Student::run_on_table() -> void {
+        // Nothing but termination messages is sent to students here, they're polled for between accesses.
+        const auto termination = Termination::current();
+        // Run until bounded run is over, infinitely if unbounded.
+        while (true) {
+            __demand = __workload.volume(__rng);
+            debug(format("DEMAND: {}"), __demand);
+
+            auto waiting = false;
+            while (__demand != 0) {
+                if (termination != nullptr) {
+                    termination->poll();
+                }
+                // Nobody announces new stock, the table is read before every choice instead.
+                __table->read(__safehouses);
+                for (uint64_t safehouse = 0; safehouse < __safehouses.size(); ++safehouse) {
+                    __selector.update(safehouse);
+                }
+                const auto safehouse = __selector.select(__rng);
+                if (safehouse == SafehouseIndex::NONE) {
+                    if (!waiting) {
+                        trace(format("ALL SAFEHOUSES EMPTY."));
                     }
-                    trace(format("ACK COUNTER: {}"), __ack_counter);
+                    waiting = true;
+                    std::this_thread::yield();
+                    continue;
                 }
+                waiting = false;
 
-                if (skip_safehouse) {
-                    skip_safehouse = false;
+                trace(format("CHOSEN SAFEHOUSE: {}"), safehouse);
+                const auto requested_at = Transport::current().now();
+                const auto consumption = __table->consume(safehouse, __demand);
+                Metrics::current().ack_wait.record(nanoseconds(requested_at, Transport::current().now()));
+                if (consumption.volume == 0) {
+                    ++Metrics::current().skips;
+                    if (termination != nullptr) {
+                        termination->record(0);
+                    }
                     continue;
                 }
 
+                // Nothing is held here, taking the wine only keeps the student busy.
+                if (const auto service_time = __workload.service_time(__rng); service_time > 0.0) {
+                    Transport::current().pause(service_time);
+                }
+
                 ++__timestamp;
-                trace(format("safehouse acquire state {{ remaining demand: {}, safehouse #{} supplies: {} }}"), __demand, __safehouse, __safehouses[__safehouse]);
-                const auto volume = std::min(static_cast<uint64_t>(__demand), __safehouses[__safehouse]);
-                __safehouses[__safehouse] -= volume;
-                __demand -= volume;
-                trace(format("safehouse release state {{ remaining demand: {}, safehouse #{} supplies: {} }}"), __demand, __safehouse, __safehouses[__safehouse]);
-
-                if (__safehouses[__safehouse] == 0) {
-                    send_broadcast(__safehouse);
+                __safehouses[safehouse] -= std::min(__safehouses[safehouse], consumption.volume);
+                __selector.update(safehouse);
+                __demand -= consumption.volume;
+                Metrics::current().wine_volume += consumption.volume;
+                if (termination != nullptr) {
+                    termination->record(consumption.volume);
                 }
+                trace(format("safehouse release state {{ remaining demand: {}, safehouse #{} took: {} }}"), __demand, safehouse, consumption.volume);
 
-                for(auto&& message : __pending_acks) {
-                    send_ack(message);
+                if (consumption.emptied) {
+                    send_broadcast(safehouse);
                 }
-                __pending_acks.clear();
             }
         }
     }
 
-    auto Student::send_req() -> void {
-        __priority = ++__timestamp;
-        Message request {
-            Message::Type::STUDENT_REQUEST,
-            __rank,
-            __timestamp,
-            Message::Payload {
-              __safehouse,
-              __demand,
-              0,
-            },
-        };
-
-        for (auto receiver = __students_start_id; receiver < __students_start_id + __students_count; ++receiver) {
-            if (receiver != __rank) {
-                request.send_to(receiver);
+    auto Student::observe(const Message& message) -> void {
+        switch (message.type) {
+            case Message::Type::WINEMAKER_BROADCAST:
+                debug(format("received WINEMAKER BROADCAST {{ timestamp: {}, sender: {}, safehouse: {}, volume: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.wine_volume);
+                learn(message.payload.safehouse_index, message.payload.wine_volume, message.timestamp);
+                break;
+            case Message::Type::STUDENT_REQUEST:
+                __selector.requested(message.payload.safehouse_index, message.timestamp);
+                break;
+            case Message::Type::STUDENT_RELEASE_REQUEST: {
+                const auto [release, request] = QuorumExclusion::split(message);
+                observe(release);
+                observe(request);
+                break;
             }
+            case Message::Type::STUDENT_ACKNOWLEDGE:
+                // Every arbiter sends the freshest release it got, the quorum intersecting the previous holder's has the latest one.
+                if (message.payload.stocked_at != 0) {
+                    learn(message.payload.safehouse_index, message.payload.wine_volume, message.payload.stocked_at);
+                }
+                break;
+            case Message::Type::STUDENT_RELEASE:
+                __selector.released(message.payload.safehouse_index);
+                // Stock left by the releasing student is stamped with the time it consumed, withdrawn requests carry none.
+                if (message.payload.wine_volume != Exclusion::NO_STOCK) {
+                    learn(message.payload.safehouse_index, message.payload.wine_volume, message.payload.last_timestamp);
+                }
+                break;
+            default:
+                break;
         }
-
-        __ack_counter = 0;
     }
 
-    auto Student::send_ack(Message request) -> void {
-        ++__timestamp;
-        Message ack {
-            /* .type = */ Message::Type::STUDENT_ACKNOWLEDGE,
-            /* .sender = */ __rank,
-            /* .timestamp = */ __timestamp,
-            /* .payload = */ Message::Payload {
-              /* .safehouse_index = */ request.payload.safehouse_index,
-              /* .wine_volume = */ 0,
-              /* .last_timestamp = */ request.timestamp,
-            }
-        };
-
-        ack.send_to(request.sender);
+    auto Student::learn(uint64_t safehouse, uint64_t stock, uint64_t at) -> void {
+        if (at <= __known_at[safehouse]) {
+            return;
+        }
+        __safehouses[safehouse] = stock;
+        __known_at[safehouse] = at;
+        __selector.update(safehouse);
     }
 
     auto Student::send_broadcast(uint64_t safehouse) -> void {
-        debug(format("emptied out safehouse #{}."), __safehouse);
+        debug(format("emptied out safehouse #{}."), safehouse);
 
         ++__timestamp;
         Message broadcast {
@@ -167,11 +263,17 @@ namespace nouveaux {
               /* .safehouse_index = */ safehouse,
               /* .wine_volume = */ 0,
               /* .last_timestamp = */ 0,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
             }
         };
 
-        for (auto receiver = __winemakers_start_id; receiver < __winemakers_start_id + __winemakers_count; ++receiver) {
-            broadcast.send_to(receiver);
+        if (auto overlay = Overlay::current()) {
+            overlay->send(broadcast, Overlay::Group { __winemakers_start_id, __winemakers_count });
+            return;
         }
+        broadcast.send_to(__broadcast_fanout);
     }
-}
\ No newline at end of file
+}
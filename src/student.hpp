@@ -1,21 +1,29 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <random>
 #include <vector>
 
+#include "exclusion.hpp"
 #include "message.hpp"
+#include "selection.hpp"
+#include "workload.hpp"
 
 namespace nouveaux {
+
+    class StockTable;
+
     class Student {
 #if defined(NOUVEAUX_DEBUG)
       public:
 #endif
         // Random number generator for generating wine demand.
+        // Seeded by whoever spawns the actor, fixed seeds make runs repeatable.
         std::mt19937 __rng;
-        // Random number distribution for limiting possible demand.
-        // In theory this could be **any** distribution, uniform was just arbitrarily chosen.
-        std::uniform_int_distribution<> __dist;
+        // Model wine demand is drawn from, together with time each acquisition keeps actor busy.
+        Workload __workload;
         // Current wine demand.
         //
         // MUTABILITY: Should change only:
@@ -25,38 +33,37 @@ namespace nouveaux {
         // State of available wine supplies in every safehouse.
         //
         // MUTABILITY: Should change only:
-        //     1) When received WINEMAKER_BROADCAST message.
-        //     2) When received STUDENT_ACQUISITION_REQ message.
-        //     3) When student acquire safehouse.
+        //     1) When received WINEMAKER_BROADCAST or STUDENT_RELEASE message newer than what's known.
+        //     2) When student acquire safehouse (token protocol brings actual stock along).
+        //     3) When wine is consumed.
         //
         // SAFETY: Every modification on this vector should be checked for overflow,
         // as it's highly possible to try to insert negative value here.
         // Integer overflow in C++ is Undefined Behavior.
         std::vector<uint64_t> __safehouses;
+        // Lamport time of the newest known stock of every safehouse, older news is ignored.
+        //
+        // MUTABILITY: Should change together with `__safehouses`.
+        std::vector<uint64_t> __known_at;
+        // Index of non-empty safehouses and policy choosing which one to acquire.
+        //
+        // MUTABILITY: Should be updated every time `__safehouses` changes and on every STUDENT_REQUEST and STUDENT_RELEASE.
+        Selector __selector;
         // Lamport logical clock for message timestamps.
         //
         // MUTABILITY: Should change on internal events and when message is sent or received.
-        uint64_t __timestamp;
-        // Lamport clock state for last sent REQ message.
-        //
-        // MUTABILITY: Should change only when REQ message is being sent.
-        uint64_t __priority;
-        // Currently chosen safehouse index.
+        //     Shared with the progress thread answering requests, so it only ever moves by atomic increments.
+        std::atomic<uint64_t> __timestamp;
+        // Currently chosen safehouses, ascending. More than one only when demand exceeds the first one's stock.
         //
         // MUTABILITY: Should change only when new safehouse acquisition is started.
-        uint64_t __safehouse;
-        // Number of received ACKs when acquiring safehouse.
-        //
-        // MUTABILITY: Should change only:
-        //     1) When received STUDENT_ACQUISITION_ACK message with apropriate safehouse index.
-        //     2) When received STUDENT_ACQUISITION_REQ message with apropriate safehouse index and higher timestamp than current priority.
-        uint64_t __ack_counter;
-        // List of processes waiting for ACK with corresponding safehouse index.
-        //
-        // MUTABILITY: Should change only:
-        //     1) When received STUDENT_ACQUISITION_REQ message with apropriate safehouse index and higher timestamp than current priority.
-        //     2) When student acquired safehouse and modified apropriate values.
-        std::vector<Message> __pending_acks;
+        std::vector<uint64_t> __batch;
+        // Most safehouses acquired together, one disables batching.
+        const uint64_t __batch_limit;
+        // Safehouse mutual exclusion protocol, every received message goes through it.
+        std::unique_ptr<Exclusion> __exclusion;
+        // Shared stock table consumed with one-sided atomics, nullptr when stock is kept in messages.
+        StockTable* const __table;
         // Lower (inclusive) bound of students' ids.
         const uint64_t __students_start_id;
         // Number of students.
@@ -67,14 +74,20 @@ namespace nouveaux {
         const uint64_t __winemakers_count;
         // Process's own id.
         const uint32_t __rank;
+        // Persistent sends of STUDENT_BROADCAST messages to all winemakers.
+        Transport::Fanout __broadcast_fanout;
 
       public:
-        Student(uint64_t safehouse_count, uint32_t rank, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count, uint32_t min_wine_volume, uint32_t max_wine_volume);
+        Student(uint64_t safehouse_count, uint32_t rank, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count, const Workload::Settings& workload, uint64_t seed, Selector::Policy selection, Exclusion::Mode exclusion, uint64_t batch_limit);
         auto run() -> void;
 
       private:
-        auto send_req() -> void;
-        auto send_ack(Message request) -> void;
+        // Consumes straight from the stock table with one-sided atomics, no exclusion protocol involved.
+        auto run_on_table() -> void;
+        // Keeps safehouse view and selector up to date, protocol messages are already handled by `__exclusion`.
+        auto observe(const Message& message) -> void;
+        // Takes `stock` as current unless something newer than `at` is already known.
+        auto learn(uint64_t safehouse, uint64_t stock, uint64_t at) -> void;
         auto send_broadcast(uint64_t safehouse) -> void;
     };
 }
@@ -13,4 +13,31 @@ constexpr int STUDENT_BROADCAST =     0b00001000;
 // Student wine acquisition REQ message.
 constexpr int STUDENT_ACQUIRE_REQ =   0b00010000;
 // Student wine acquisition ACK message.
-constexpr int STUDENT_ACQUIRE_ACK =   0b00100000;
\ No newline at end of file
+constexpr int STUDENT_ACQUIRE_ACK =   0b00100000;
+// Student quorum release message.
+constexpr int STUDENT_RELEASE =       0b01000000;
+// Student quorum inquire message (arbiter asks grant holder to yield).
+constexpr int STUDENT_INQUIRE =       0b10000000;
+// Student quorum relinquish message (holder yields grant back to arbiter).
+constexpr int STUDENT_RELINQUISH =    0b100000000;
+// Student quorum failed message (arbiter cannot grant request right now).
+constexpr int STUDENT_FAILED =        0b1000000000;
+// Safehouse token request, forwarded towards current token holder.
+constexpr int TOKEN_REQUEST =         0b10000000000;
+// Safehouse token (together with safehouse stock) passed to next holder.
+constexpr int TOKEN =                 0b100000000000;
+// Student quorum release piggybacked on next request.
+constexpr int STUDENT_RELEASE_REQ =   0b1000000000000;
+// Actor met the bound of a bounded run.
+constexpr int DONE =                  0b10000000000000;
+// Bounded run is over, every actor stops.
+constexpr int FINISH =                0b100000000000000;
+// One-hot values would exceed 32767, the largest tag MPI guarantees, so tags below are sequential.
+// Safehouse lock request sent to its manager.
+constexpr int LOCK_REQUEST =          0b100000000000001;
+// Safehouse lock (together with safehouse stock) granted by its manager.
+constexpr int LOCK_GRANT =            0b100000000000010;
+// Safehouse lock (together with safehouse stock) given back to its manager.
+constexpr int LOCK_RELEASE =          0b100000000000011;
+// Winemaker ACK piggybacked on next REQ to the same peer.
+constexpr int WINEMAKER_ACK_REQ =     0b100000000000100;
\ No newline at end of file
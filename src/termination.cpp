@@ -0,0 +1,123 @@
+#include "termination.hpp"
+
+#include "logger.hpp"
+
+namespace nouveaux {
+
+    namespace {
+        thread_local Termination* __current = nullptr;
+    }
+
+    Termination::Termination(const Bounds& bounds, uint32_t rank, uint64_t size)
+      : __bounds(bounds),
+        __rank(rank),
+        __size(size),
+        __started_at(Transport::current().now()),
+        __rounds(0),
+        __wine_volume(0),
+        __done(false),
+        __done_count(0) {
+        // Actor blocked with nothing to receive still has to notice its time is up.
+        if (__bounds.duration > 0.0) {
+            Transport::current().wake_at(__started_at + __bounds.duration);
+        }
+    }
+
+    auto Termination::record(uint64_t volume) -> void {
+        ++__rounds;
+        __wine_volume += volume;
+        check();
+    }
+
+    auto Termination::handle(const Message& message) -> bool {
+        check();
+        switch (message.type) {
+            case Message::Type::DONE:
+                debug("ACTOR #{} received DONE {{ sender: {} }}", __rank, message.sender);
+                arrive();
+                return true;
+            case Message::Type::FINISH:
+                trace("ACTOR #{} FINISHED after {} rounds.", __rank, __rounds);
+                throw Finished {};
+            case Message::Type::UNKNOWN:
+                // Transport's wake-up at the duration bound, checked above.
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    auto Termination::poll() -> void {
+        check();
+        Message message;
+        while (Message::poll(message)) {
+            handle(message);
+        }
+    }
+
+    auto Termination::concerns(const Message& message) -> bool {
+        return message.type == Message::Type::DONE || message.type == Message::Type::FINISH;
+    }
+
+    auto Termination::check() -> void {
+        if (__done) {
+            return;
+        }
+        const auto rounds = __bounds.rounds != 0 && __rounds >= __bounds.rounds;
+        const auto volume = __bounds.wine_volume != 0 && __wine_volume >= __bounds.wine_volume;
+        const auto expired = __bounds.duration > 0.0 && Transport::current().now() - __started_at >= __bounds.duration;
+        if (!rounds && !volume && !expired) {
+            return;
+        }
+
+        trace("ACTOR #{} DONE after {} rounds, {} units.", __rank, __rounds, __wine_volume);
+        __done = true;
+        if (__rank == COORDINATOR) {
+            arrive();
+        } else {
+            send(Message::Type::DONE, COORDINATOR);
+        }
+    }
+
+    auto Termination::arrive() -> void {
+        if (++__done_count < __size) {
+            return;
+        }
+
+        for (uint64_t actor = 0; actor < __size; ++actor) {
+            if (actor != __rank) {
+                send(Message::Type::FINISH, actor);
+            }
+        }
+        trace("ACTOR #{} FINISHED after {} rounds.", __rank, __rounds);
+        throw Finished {};
+    }
+
+    auto Termination::send(Message::Type type, uint64_t receiver) -> void {
+        // Not part of any protocol, no Lamport time to carry.
+        Message message {
+            /* .type = */ type,
+            /* .sender = */ __rank,
+            /* .timestamp = */ 0,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ 0,
+              /* .wine_volume = */ 0,
+              /* .last_timestamp = */ 0,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            },
+        };
+
+        message.send_to(receiver);
+    }
+
+    auto Termination::bind(Termination* termination) -> void {
+        __current = termination;
+    }
+
+    auto Termination::current() -> Termination* {
+        return __current;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+#include "message.hpp"
+
+namespace nouveaux {
+
+    // Bounded run, every actor stops once all of them met their bound.
+    //
+    // Actor meeting its bound (rounds, wine volume or seconds, whichever comes first) tells the coordinator
+    // with DONE once and keeps working, so that peers still short of theirs don't starve. Once coordinator
+    // counted every actor it sends FINISH to all of them. Receiving it throws `Finished`, which unwinds actor's
+    // `run()` wherever it blocks. Requests and acknowledgements still in flight are left for the transport to drain.
+    class Termination {
+      public:
+        // Thrown once actor has to stop.
+        struct Finished {};
+
+        // Bounds of single actor, zero means unbounded.
+        struct Bounds {
+            // Acquisitions, given up ones included.
+            uint64_t rounds;
+            // Wine produced by winemaker or consumed by student.
+            uint64_t wine_volume;
+            // Seconds since actor started (virtual ones when simulated).
+            double duration;
+
+            [[nodiscard]] auto unbounded() const -> bool { return rounds == 0 && wine_volume == 0 && duration <= 0.0; }
+        };
+
+        // Actor counting DONE messages.
+        static constexpr uint64_t COORDINATOR = 0;
+
+      private:
+        const Bounds __bounds;
+        // Process's own id.
+        const uint32_t __rank;
+        // Number of actors.
+        const uint64_t __size;
+        const double __started_at;
+        uint64_t __rounds;
+        uint64_t __wine_volume;
+        // Whether DONE was sent already.
+        bool __done;
+        // Coordinator only, number of actors done.
+        uint64_t __done_count;
+
+      public:
+        Termination(const Bounds& bounds, uint32_t rank, uint64_t size);
+        Termination(const Termination&) = delete;
+        auto operator=(const Termination&) -> Termination& = delete;
+
+        // Counts finished (or given up) acquisition together with wine volume produced or consumed in it.
+        auto record(uint64_t volume) -> void;
+        // Takes termination messages and transport wake-ups, returns false for any other one. Throws `Finished` on FINISH.
+        auto handle(const Message& message) -> bool;
+        // Checks the bound and handles messages already delivered without blocking.
+        // Only for actors which never receive anything else, other messages are dropped.
+        auto poll() -> void;
+        [[nodiscard]] static auto concerns(const Message& message) -> bool;
+
+        static auto bind(Termination* termination) -> void;
+        // nullptr when run is unbounded.
+        [[nodiscard]] static auto current() -> Termination*;
+
+      private:
+        // Reports DONE once bound is met.
+        auto check() -> void;
+        // Coordinator only, finishes once every actor is done.
+        auto arrive() -> void;
+        auto send(Message::Type type, uint64_t receiver) -> void;
+    };
+}
@@ -0,0 +1,137 @@
+#include "token_exclusion.hpp"
+
+#include "logger.hpp"
+#include "metrics.hpp"
+
+#define format(fmt) "[{:0>10}] TOKEN #{} " fmt, __clock.load(std::memory_order_relaxed), __rank
+
+namespace nouveaux {
+
+    TokenExclusion::TokenExclusion(std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t students_start_id, uint64_t winemakers_start_id, uint64_t winemakers_count)
+      : Exclusion(clock, rank),
+        __tokens(safehouse_count),
+        __safehouse(NONE) {
+        for (uint64_t safehouse = 0; safehouse < safehouse_count; ++safehouse) {
+            const auto holder = initial_holder(safehouse, students_start_id, winemakers_start_id, winemakers_count);
+            __tokens[safehouse] = Token { holder == rank ? NONE : holder, NONE, holder == rank, false, 0 };
+        }
+    }
+
+    auto TokenExclusion::initial_holder(uint64_t safehouse, uint64_t students_start_id, uint64_t winemakers_start_id, uint64_t winemakers_count) -> uint64_t {
+        // Winemaker bound to the safehouse, so that first stocking doesn't need any message.
+        if (winemakers_count == 0) {
+            return students_start_id;
+        }
+        return winemakers_start_id + safehouse % winemakers_count;
+    }
+
+    auto TokenExclusion::acquire(uint64_t safehouse, const Observer& observer) -> bool {
+        __safehouse = safehouse;
+        auto& token = __tokens[safehouse];
+        token.requesting = true;
+        if (token.last != NONE) {
+            send_request(safehouse, __rank, token.last);
+            token.last = NONE;
+        } else if (token.present) {
+            ++Metrics::current().reuses;
+        }
+
+        while (!token.present) {
+            auto message = receive();
+            handle(message);
+            observer(message);
+        }
+
+        trace(format("HOLDS TOKEN #{} {{ stock: {} }}"), safehouse, token.stock);
+        return true;
+    }
+
+    auto TokenExclusion::release() -> void {
+        auto& token = __tokens[__safehouse];
+        token.requesting = false;
+        if (token.next != NONE) {
+            send_token(__safehouse, token.next);
+        }
+        __safehouse = NONE;
+    }
+
+    auto TokenExclusion::stock() -> uint64_t* {
+        if (__safehouse == NONE || !__tokens[__safehouse].present) {
+            return nullptr;
+        }
+        return &__tokens[__safehouse].stock;
+    }
+
+    auto TokenExclusion::handle(const Message& message) -> void {
+        switch (message.type) {
+            case Message::Type::TOKEN_REQUEST: {
+                debug(format("received TOKEN REQUEST {{ timestamp: {}, sender: {}, safehouse: {}, origin: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.origin);
+                const auto safehouse = message.payload.safehouse_index;
+                auto& token = __tokens[safehouse];
+                if (token.last != NONE) {
+                    send_request(safehouse, message.payload.origin, token.last);
+                } else if (token.requesting) {
+                    token.next = message.payload.origin;
+                } else {
+                    send_token(safehouse, message.payload.origin);
+                }
+                // Requester is the most recent one now, later requests queue up behind it.
+                token.last = message.payload.origin;
+                break;
+            }
+            case Message::Type::TOKEN: {
+                debug(format("received TOKEN {{ timestamp: {}, sender: {}, safehouse: {}, stock: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.wine_volume);
+                auto& token = __tokens[message.payload.safehouse_index];
+                token.present = true;
+                token.stock = message.payload.wine_volume;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    auto TokenExclusion::send_request(uint64_t safehouse, uint64_t requester, uint64_t receiver) -> void {
+        ++__clock;
+        Message request {
+            /* .type = */ Message::Type::TOKEN_REQUEST,
+            /* .sender = */ __rank,
+            /* .timestamp = */ __clock,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ safehouse,
+              /* .wine_volume = */ 0,
+              /* .last_timestamp = */ 0,
+              /* .origin = */ requester,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            },
+        };
+
+        request.send_to(receiver);
+    }
+
+    auto TokenExclusion::send_token(uint64_t safehouse, uint64_t receiver) -> void {
+        auto& token = __tokens[safehouse];
+        token.present = false;
+        token.next = NONE;
+
+        ++__clock;
+        Message message {
+            /* .type = */ Message::Type::TOKEN,
+            /* .sender = */ __rank,
+            /* .timestamp = */ __clock,
+            /* .payload = */ Message::Payload {
+              /* .safehouse_index = */ safehouse,
+              /* .wine_volume = */ token.stock,
+              /* .last_timestamp = */ 0,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
+            },
+        };
+
+        message.send_to(receiver);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "exclusion.hpp"
+
+namespace nouveaux {
+
+    // Token protocol shared by winemakers and students: one token per safehouse (Naimi-Trehel).
+    //
+    // Token carries the safehouse stock, so its holder always sees the real amount of wine.
+    // Requests travel along `last` pointers to the most recent requester, which either passes
+    // an idle token right away or queues the requester as `next`. Holder which wasn't asked
+    // for the token meanwhile enters again without any message.
+    //
+    // Batches are acquired one safehouse after another: queue position can't be given up, token of a
+    // withdrawn request would still pass through the requester on its way to everyone queued behind it.
+    class TokenExclusion : public Exclusion {
+#if defined(NOUVEAUX_DEBUG)
+      public:
+#endif
+        struct Token {
+            // Probable holder requests are sent to, NONE when this process asked last (it's the root).
+            uint64_t last;
+            // Requester token is passed to on release, NONE when nobody asked.
+            uint64_t next;
+            // Whether token is here.
+            bool present;
+            // Whether this process wants the token or holds it in critical section.
+            bool requesting;
+            // Wine in safehouse, valid only while token is here.
+            uint64_t stock;
+        };
+        // Per safehouse token state.
+        //
+        // MUTABILITY: Should change only when safehouse is acquired or released, or received TOKEN_REQUEST or TOKEN.
+        std::vector<Token> __tokens;
+        // Safehouse currently acquired or held, NONE when there is none.
+        //
+        // MUTABILITY: Should change only when safehouse is acquired or released.
+        uint64_t __safehouse;
+
+      public:
+        static constexpr uint64_t NONE = UINT64_MAX;
+
+        TokenExclusion(std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t students_start_id, uint64_t winemakers_start_id, uint64_t winemakers_count);
+
+        auto handle(const Message& message) -> void override;
+        // Request can't be withdrawn once sent, observer can't abandon acquisition.
+        [[nodiscard]] auto acquire(uint64_t safehouse, const Observer& observer) -> bool override;
+        auto release() -> void override;
+        [[nodiscard]] auto stock() -> uint64_t* override;
+
+        // Process holding token of `safehouse` before anyone asked for it.
+        [[nodiscard]] static auto initial_holder(uint64_t safehouse, uint64_t students_start_id, uint64_t winemakers_start_id, uint64_t winemakers_count) -> uint64_t;
+
+      private:
+        auto send_request(uint64_t safehouse, uint64_t requester, uint64_t receiver) -> void;
+        auto send_token(uint64_t safehouse, uint64_t receiver) -> void;
+    };
+}
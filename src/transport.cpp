@@ -0,0 +1,23 @@
+#include "transport.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace nouveaux {
+
+    namespace {
+        thread_local Transport* __current = nullptr;
+    }
+
+    auto Transport::pause(double seconds) -> void {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    }
+
+    auto Transport::bind(Transport& transport) -> void {
+        __current = &transport;
+    }
+
+    auto Transport::current() -> Transport& {
+        return *__current;
+    }
+}
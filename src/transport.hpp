@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace nouveaux {
+
+    struct Message;
+
+    // Message delivery backend used by `Message::send_to` and `Message::receive_from`.
+    //
+    // Every thread running an actor binds its own transport endpoint with `bind`,
+    // so the same `Winemaker` and `Student` code runs over MPI (one actor per rank)
+    // or in a single process (one actor per thread).
+    class Transport {
+      public:
+        // Fixed set of receivers a message type is repeatedly sent to.
+        //
+        // Backend may attach its own state on first use (eg. persistent MPI requests),
+        // it's released together with the fan-out.
+        class Fanout {
+          public:
+            struct State {
+                virtual ~State() = default;
+            };
+
+          private:
+            std::vector<uint64_t> __receivers;
+            std::unique_ptr<State> __state;
+
+          public:
+            explicit Fanout(std::vector<uint64_t> receivers)
+              : __receivers(std::move(receivers)),
+                __state(nullptr) {}
+
+            [[nodiscard]] auto receivers() const -> const std::vector<uint64_t>& { return __receivers; }
+            [[nodiscard]] auto state() -> std::unique_ptr<State>& { return __state; }
+        };
+
+        // Handles message on transport's progress thread, returns true if it's done and must not reach `receive`.
+        using Responder = std::function<bool(const Message&)>;
+
+        virtual ~Transport() = default;
+
+        virtual auto send(const Message& message, uint64_t receiver) -> void = 0;
+        virtual auto send(const Message& message, Fanout& fanout) -> void = 0;
+        [[nodiscard]] virtual auto receive(int source) -> Message = 0;
+        // Takes the oldest received message without blocking, returns false if there is none.
+        // Transports unable to tell without blocking never return anything.
+        [[nodiscard]] virtual auto try_receive(Message&) -> bool { return false; }
+        // Seconds since arbitrary point in time, virtual time when simulated.
+        [[nodiscard]] virtual auto now() const -> double = 0;
+        // Keeps the actor busy for `seconds` (of virtual time when simulated), messages wait meanwhile.
+        virtual auto pause(double seconds) -> void;
+        // Lets transport with a progress thread answer messages without waiting for the actor,
+        // `responder` is called there for every received message. Empty responder detaches it.
+        // Transports without progress thread ignore it.
+        virtual auto respond_with(Responder) -> void {}
+        // Once `now()` reaches `time`, `receive` blocked without any message returns a wake-up instead
+        // (UNKNOWN message), so that actor gets to check bounds of its run. Only the latest call counts.
+        virtual auto wake_at(double /* time */) -> void {}
+
+        // Makes `transport` the endpoint of calling thread.
+        static auto bind(Transport& transport) -> void;
+        [[nodiscard]] static auto current() -> Transport&;
+    };
+}
@@ -1,115 +1,217 @@
 #include "winemaker.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
+#include "group_exclusion.hpp"
 #include "logger.hpp"
+#include "manager_exclusion.hpp"
+#include "metrics.hpp"
+#include "overlay.hpp"
+#include "stock_table.hpp"
 #include "tags.hpp"
+#include "termination.hpp"
+#include "token_exclusion.hpp"
 
-#define format(fmt) "[{:0>10}] WINEMAKER #{} " fmt, __timestamp, __rank
+#define format(fmt) "[{:0>10}] WINEMAKER #{} " fmt, __timestamp.load(std::memory_order_relaxed), __rank
 
 namespace nouveaux {
-    Winemaker::Winemaker(uint64_t safehouse_count, uint32_t rank, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count, uint32_t min_wine_volume, uint32_t max_wine_volume)
-      : __rng(std::random_device()()),
-        __dist(min_wine_volume, max_wine_volume),
+    namespace {
+        auto range_of(uint64_t start_id, uint64_t count) -> std::vector<uint64_t> {
+            std::vector<uint64_t> range;
+            for (auto id = start_id; id < start_id + count; ++id) {
+                range.push_back(id);
+            }
+            return range;
+        }
+
+        // Every other winemaker learns from broadcasts which safehouses are stocked only when leasing.
+        // Students read the stock table instead, if there is one.
+        auto broadcast_range_of(uint32_t rank, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count, bool leasing, bool table) -> std::vector<uint64_t> {
+            auto range = table ? std::vector<uint64_t> {} : range_of(students_start_id, students_count);
+            if (leasing) {
+                for (auto id = winemakers_start_id; id < winemakers_start_id + winemakers_count; ++id) {
+                    if (id != rank) {
+                        range.push_back(id);
+                    }
+                }
+            }
+            return range;
+        }
+
+        auto vacant_of(uint64_t safehouse_count) -> SafehouseIndex {
+            SafehouseIndex vacant(safehouse_count);
+            for (uint64_t safehouse = 0; safehouse < safehouse_count; ++safehouse) {
+                vacant.set(safehouse);
+            }
+            return vacant;
+        }
+
+        auto exclusion_of(Exclusion::Mode mode, std::atomic<uint64_t>& clock, uint32_t rank, uint64_t safehouse_count, uint64_t students_start_id, uint64_t winemakers_start_id, uint64_t winemakers_count, bool leasing) -> std::unique_ptr<Exclusion> {
+            if (mode == Exclusion::Mode::TOKEN) {
+                return std::make_unique<TokenExclusion>(clock, rank, safehouse_count, students_start_id, winemakers_start_id, winemakers_count);
+            }
+            if (mode == Exclusion::Mode::MANAGER) {
+                return std::make_unique<ManagerExclusion>(clock, rank, safehouse_count, students_start_id, winemakers_start_id, winemakers_count);
+            }
+            return std::make_unique<GroupExclusion>(clock, rank, safehouse_count, winemakers_start_id, winemakers_count, leasing);
+        }
+    }
+
+    Winemaker::Winemaker(uint64_t safehouse_count, uint32_t rank, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count, const Workload::Settings& workload, uint64_t seed, Exclusion::Mode exclusion, bool leasing, double patience, bool pipelined)
+      : __rng(seed),
+        __workload(workload, rank),
         __timestamp(0),
-        __priority(0),
-        __safehouse(rank % safehouse_count),
-        __ack_counter(0),
-        __pending_acks({}),
+        __leasing(leasing),
+        __home(rank % safehouse_count),
+        __safehouse(__home),
+        __vacant(vacant_of(safehouse_count)),
+        __vacated_at(safehouse_count, 0),
+        __patience(patience),
+        __pipelined(pipelined && exclusion == Exclusion::Mode::PERMISSION),
+        __stocked_at(safehouse_count, -1),
+        __exclusion(exclusion_of(exclusion, __timestamp, rank, safehouse_count, students_start_id, winemakers_start_id, winemakers_count, leasing)),
+        __table(StockTable::current()),
+        __safehouse_count(safehouse_count),
         __students_start_id(students_start_id),
         __students_count(students_count),
         __winemakers_start_id(winemakers_start_id),
         __winemakers_count(winemakers_count),
-        __rank(rank) {}
+        __rank(rank),
+        __broadcast_fanout(broadcast_range_of(rank, students_start_id, students_count, winemakers_start_id, winemakers_count, leasing, __table != nullptr)) {}
 
     auto Winemaker::run() -> void {
         trace(format("STARTING."));
-        // Run infinitely
+        // Safehouse stocked by someone else meanwhile is not worth waiting for. Pipelined request
+        // is given up as well once there is an empty safehouse to lease instead.
+        const auto observer = [this](const Message& message) {
+            observe(message);
+            if (message.type == Message::Type::WINEMAKER_BROADCAST) {
+                return message.payload.safehouse_index == __safehouse;
+            }
+            const auto pipelined = __pipelined && !__vacant.test(__safehouse);
+            return pipelined && message.type == Message::Type::STUDENT_BROADCAST && lease() != SafehouseIndex::NONE;
+        };
+        auto idle_since = Transport::current().now();
+        // Run until bounded run is over, infinitely if unbounded.
         while (true) {
+            __safehouse = choose();
+            while (__safehouse == SafehouseIndex::NONE) {
+                auto message = __exclusion->receive();
+                __exclusion->handle(message);
+                observe(message);
+                __safehouse = choose();
+            }
+            const auto requested_at = Transport::current().now();
+
             info(format("sending aquire request for safehouse #{}"), __safehouse);
-            send_req();
-            __ack_counter = 0;
-
-            while (__ack_counter < __winemakers_count - 1) {
-                auto message = Message::receive_from(ANY_SOURCE);
-                __timestamp = std::max(__timestamp, message.timestamp) + 1;
-                if (message.type == Message::Type::WINEMAKER_ACKNOWLEDGE) {
-                    debug(format("received WINEMAKER ACKNOWLEDGE {{ timestamp: {}, sender: {} }}"), message.timestamp, message.sender);
-                    ++__ack_counter;
-                } else if (message.type == Message::Type::WINEMAKER_REQUEST) {
-                    debug(format("received WINEMAKER REQUEST {{ timestamp: {}, sender: {}, safehouse: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.wine_volume);
-                    if (message.timestamp < __priority || message.payload.safehouse_index != __safehouse) {
-                        send_ack(message.sender);
-                    } else if (message.timestamp == __priority && message.sender < __rank) {
-                        send_ack(message.sender);
-                    } else if (message.timestamp > __priority || (message.timestamp == __priority && message.sender > __rank)) {
-                        __pending_acks.emplace_back(message);
-                        ++__ack_counter;
-                    }
+            if (!__exclusion->acquire(__safehouse, observer)) {
+                ++Metrics::current().skips;
+                // Winemaker losing every race for shared safehouse still makes progress towards its bound.
+                if (auto termination = Termination::current()) {
+                    termination->record(0);
                 }
-                trace(format("ACK COUNTER: {}"), __ack_counter);
+                continue;
             }
 
-            auto volume = __dist(__rng);
-            send_broadcast(volume);
+            // Pipelined request waits for students first, only the rest of it is on the critical path.
+            const auto entered_at = Transport::current().now();
+            const auto available_at = std::max(requested_at, __vacated_at[__safehouse]);
+            Metrics::current().idle.record(nanoseconds(idle_since, available_at));
+            Metrics::current().ack_wait.record(nanoseconds(available_at, entered_at));
+            idle_since = entered_at;
 
-            while (true) {
-                auto message = Message::receive_from(ANY_SOURCE);
-                __timestamp = std::max(__timestamp, message.timestamp) + 1;
-                if (message.type == Message::Type::STUDENT_BROADCAST && message.payload.safehouse_index == __safehouse) {
-                    debug(format("received STUDENT BROADCAST {{ timestamp: {}, sender: {}, safehouse: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index);
-                    for (auto&& m : __pending_acks) {
-                        send_ack(m.sender);
-                    }
-                    __pending_acks.clear();
-                    break;
-                } else if (message.type == Message::Type::WINEMAKER_REQUEST) {
-                    debug(format("received WINEMAKER REQUEST {{ timestamp: {}, sender: {}, safehouse: {} }}"), message.timestamp, message.sender, message.payload.safehouse_index, message.payload.wine_volume);
-                    if (message.payload.safehouse_index != __safehouse) {
-                        send_ack(message.sender);
-                    } else {
-                        __pending_acks.emplace_back(message);
-                    }
+            // Stock table and protocols carrying the stock tell whether someone else stocked the safehouse meanwhile.
+            const auto stock = __exclusion->stock();
+            const auto left = __table != nullptr ? __table->read(__safehouse) : stock != nullptr ? *stock : 0;
+            uint32_t volume = 0;
+            if (left == 0) {
+                volume = __workload.volume(__rng);
+                // Stocking takes its time, safehouse stays held and nobody learns about the wine until it's done.
+                if (const auto service_time = __workload.service_time(__rng); service_time > 0.0) {
+                    Transport::current().pause(service_time);
+                }
+                Metrics::current().wine_volume += volume;
+                if (stock != nullptr) {
+                    *stock = volume;
                 }
+                if (__table != nullptr) {
+                    __table->deposit(__safehouse, volume);
+                }
+                __stocked_at[__safehouse] = entered_at;
+                send_broadcast(volume);
+            } else {
+                ++Metrics::current().skips;
+            }
+            __vacant.reset(__safehouse);
+            __exclusion->release();
+            if (auto termination = Termination::current()) {
+                termination->record(volume);
             }
         }
     }
 
-    auto Winemaker::send_req() -> void {
-        // Send request message for all winemakers, except itself.
-        __priority = ++__timestamp;
-        Message request {
-            /* .type = */ Message::Type::WINEMAKER_REQUEST,
-            /* .sender = */ __rank,
-            /* .timestamp = */ __timestamp,
-            /* .payload = */ Message::Payload {
-              /* .safehouse_index = */ __safehouse,
-              /* .wine_volume = */ 0,
-              /* .last_timestamp = */ 0,
-            },
-        };
+    auto Winemaker::choose() -> uint64_t {
+        if (__vacant.test(__home)) {
+            return __home;
+        }
+        if (const auto safehouse = lease(); safehouse != SafehouseIndex::NONE) {
+            return safehouse;
+        }
+        // Own safehouse stocked by this winemaker is requested again right away when pipelining.
+        if (__pipelined && __stocked_at[__home] >= 0) {
+            return __home;
+        }
+        return SafehouseIndex::NONE;
+    }
 
-        for (auto receiver = __winemakers_start_id; receiver < __winemakers_start_id + __winemakers_count; ++receiver) {
-            if (receiver != __rank) {
-                request.send_to(receiver);
-            }
+    auto Winemaker::lease() -> uint64_t {
+        if (!__leasing || __vacant.empty()) {
+            return SafehouseIndex::NONE;
         }
+
+        // Random start spreads winemakers over empty safehouses, jitter keeps them from all giving up
+        // waiting for the same owner at once.
+        const auto now = Transport::current().now();
+        const auto patience = __patience * std::uniform_real_distribution<>(1.0, 2.0)(__rng);
+        const auto start = __vacant.nth(std::uniform_int_distribution<uint64_t>(0, __vacant.count() - 1)(__rng));
+        auto safehouse = start;
+        do {
+            if (!owned(safehouse) || now - __vacated_at[safehouse] >= patience) {
+                return safehouse;
+            }
+            safehouse = __vacant.next(safehouse + 1);
+            if (safehouse == SafehouseIndex::NONE) {
+                safehouse = __vacant.first();
+            }
+        } while (safehouse != start);
+        return SafehouseIndex::NONE;
     }
 
-    auto Winemaker::send_ack(uint64_t receiver) -> void {
-        ++__timestamp;
-        Message ack {
-            /* .type = */ Message::Type::WINEMAKER_ACKNOWLEDGE,
-            /* .sender = */ __rank,
-            /* .timestamp = */ __timestamp,
-            /* .payload = */ Message::Payload {
-              /* .safehouse_index = */ 0,
-              /* .wine_volume = */ 0,
-              /* .last_timestamp = */ 0,
-            },
-        };
+    auto Winemaker::owned(uint64_t safehouse) const -> bool {
+        return __winemakers_count >= __safehouse_count || (safehouse + __safehouse_count - __winemakers_start_id % __safehouse_count) % __safehouse_count < __winemakers_count;
+    }
 
-        ack.send_to(receiver);
+    auto Winemaker::observe(const Message& message) -> void {
+        const auto safehouse = message.payload.safehouse_index;
+        switch (message.type) {
+            case Message::Type::STUDENT_BROADCAST:
+                debug(format("received STUDENT BROADCAST {{ timestamp: {}, sender: {}, safehouse: {} }}"), message.timestamp, message.sender, safehouse);
+                if (__stocked_at[safehouse] >= 0) {
+                    Metrics::current().hold.record(nanoseconds(__stocked_at[safehouse], Transport::current().now()));
+                    __stocked_at[safehouse] = -1;
+                }
+                __vacant.set(safehouse);
+                __vacated_at[safehouse] = Transport::current().now();
+                break;
+            case Message::Type::WINEMAKER_BROADCAST:
+                debug(format("received WINEMAKER BROADCAST {{ timestamp: {}, sender: {}, safehouse: {}, volume: {} }}"), message.timestamp, message.sender, safehouse, message.payload.wine_volume);
+                __vacant.reset(safehouse);
+                break;
+            default:
+                break;
+        }
     }
 
     auto Winemaker::send_broadcast(uint32_t volume) -> void {
@@ -125,11 +227,23 @@ namespace nouveaux {
               /* .safehouse_index = */ __safehouse,
               /* .wine_volume = */ volume,
               /* .last_timestamp = */ 0,
+              /* .origin = */ __rank,
+              /* .released_index = */ 0,
+              /* .stocked_at = */ 0,
+              /* .batch = */ 0,
             },
         };
 
-        for (auto receiver = __students_start_id; receiver < __students_start_id + __students_count; ++receiver) {
-            broadcast.send_to(receiver);
+        // Tree reaches the same receivers as the fan-out, broadcaster sends only to its children.
+        if (auto overlay = Overlay::current()) {
+            if (__table == nullptr) {
+                overlay->send(broadcast, Overlay::Group { __students_start_id, __students_count });
+            }
+            if (__leasing) {
+                overlay->send(broadcast, Overlay::Group { __winemakers_start_id, __winemakers_count });
+            }
+            return;
         }
+        broadcast.send_to(__broadcast_fanout);
     }
 }
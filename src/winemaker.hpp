@@ -1,44 +1,69 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <random>
 #include <vector>
 
+#include "exclusion.hpp"
 #include "message.hpp"
+#include "selection.hpp"
+#include "workload.hpp"
 
 namespace nouveaux {
+
+    class StockTable;
+
     class Winemaker {
 #if defined(NOUVEAUX_DEBUG)
       public:
 #endif
         // Random number generator for generating wine supply.
+        // Seeded by whoever spawns the actor, fixed seeds make runs repeatable.
         std::mt19937 __rng;
-        // Random number distribution for limiting possible supply.
-        // In theory this could be **any** distribution, uniform was just arbitrarily chosen.
-        std::uniform_int_distribution<> __dist;
+        // Model wine supply is drawn from, together with time each acquisition keeps actor busy.
+        Workload __workload;
         // Lamport logical clock for message timestamps.
         //
         // MUTABILITY: Should change every time internal event happen or when message is sent or received.
-        uint64_t __timestamp;
-        // Lamport clock state for last sent REQ message.
+        //     Shared with the progress thread answering requests, so it only ever moves by atomic increments.
+        std::atomic<uint64_t> __timestamp;
+        // Whether winemaker stocks any safehouse it believes empty or only its own one.
+        const bool __leasing;
+        // Own safehouse, <winemakers id> mod <safehouse count>. Without leasing it's the only one
+        // winemaker stocks, with leasing it's just preferred so that winemakers rarely compete.
+        const uint64_t __home;
+        // Safehouse currently leased (or requested).
         //
-        // MUTABILITY: Should change only when REQ message is being sent.
-        uint64_t __priority;
-        // For simplicity & scalability every winemaker tries to acquire every time the same safehouse.
-        // By convention this safehouse will be <winemakers id> mod <safehouse count>.
-        const uint64_t __safehouse;
-        // Number of received ACKs when acquiring safehouse.
+        // MUTABILITY: Should change only when new safehouse acquisition is started.
+        uint64_t __safehouse;
+        // Safehouses known to be empty, only those are worth stocking.
         //
         // MUTABILITY: Should change only:
-        //     1) When received STUDENT_ACQUISITION_ACK message with apropriate safehouse index.
-        //     2) When received STUDENT_ACQUISITION_REQ message with apropriate safehouse index and higher timestamp than current priority.
-        uint64_t __ack_counter;
-        // List of processes waiting for ACK with corresponding safehouse index.
+        //     1) When safehouse is stocked (or found stocked), also by another winemaker (WINEMAKER_BROADCAST).
+        //     2) When received STUDENT_BROADCAST for it.
+        SafehouseIndex __vacant;
+        // Time every safehouse was last reported empty.
         //
-        // MUTABILITY: Should change only:
-        //     1) When received STUDENT_ACQUISITION_REQ message with apropriate safehouse index and higher timestamp than current priority.
-        //     2) When student acquired safehouse and modified apropriate values.
-        std::vector<Message> __pending_acks;
+        // MUTABILITY: Should change only when received STUDENT_BROADCAST.
+        std::vector<double> __vacated_at;
+        // Seconds safehouse of another winemaker has to stay empty before it's leased, so that its own
+        // winemaker gets the chance to restock it first (and keeps its permissions).
+        const double __patience;
+        // Whether next round's request for own safehouse goes out while students still drain it.
+        // Only permission protocol supports it, token would be taken away from students.
+        const bool __pipelined;
+        // Time every safehouse was stocked by this winemaker, negative when it wasn't.
+        //
+        // MUTABILITY: Should change only when safehouse is stocked and received STUDENT_BROADCAST for it.
+        std::vector<double> __stocked_at;
+        // Safehouse mutual exclusion protocol, every received message goes through it.
+        std::unique_ptr<Exclusion> __exclusion;
+        // Shared stock table, nullptr when students learn the stock from broadcasts.
+        StockTable* const __table;
+        // Number of safehouses.
+        const uint64_t __safehouse_count;
         // Lower (inclusive) bound of students' ids.
         const uint64_t __students_start_id;
         // Number of students.
@@ -49,14 +74,24 @@ namespace nouveaux {
         const uint64_t __winemakers_count;
         // Process's own id.
         const uint32_t __rank;
+        // Persistent sends of WINEMAKER_BROADCAST messages to all students unless there is a stock table
+        // (and other winemakers when leasing).
+        Transport::Fanout __broadcast_fanout;
 
       public:
-        Winemaker(uint64_t safehouse_count, uint32_t rank, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count, uint32_t min_wine_volume, uint32_t max_wine_volume);
+        Winemaker(uint64_t safehouse_count, uint32_t rank, uint64_t students_start_id, uint64_t students_count, uint64_t winemakers_start_id, uint64_t winemakers_count, const Workload::Settings& workload, uint64_t seed, Exclusion::Mode exclusion, bool leasing, double patience, bool pipelined);
         auto run() -> void;
 
       private:
-        auto send_req() -> void;
-        auto send_ack(uint64_t receiver) -> void;
+        // Tracks emptiness of safehouses, protocol messages are already handled by `__exclusion`.
+        auto observe(const Message& message) -> void;
+        // Safehouse to stock next: own one if empty, then any other to lease, then own one pipelined.
+        // `SafehouseIndex::NONE` if there is none.
+        [[nodiscard]] auto choose() -> uint64_t;
+        // Empty safehouse of another winemaker (or nobody's) worth leasing, `SafehouseIndex::NONE` if there is none.
+        [[nodiscard]] auto lease() -> uint64_t;
+        // Whether any winemaker has `safehouse` as its own one.
+        [[nodiscard]] auto owned(uint64_t safehouse) const -> bool;
         auto send_broadcast(uint32_t volume) -> void;
     };
 
@@ -0,0 +1,140 @@
+#include "workload.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <spdlog/fmt/fmt.h>
+
+namespace nouveaux {
+
+    namespace {
+        auto zipf_of(const Workload::Settings& settings) -> std::discrete_distribution<> {
+            if (settings.model != Workload::Model::ZIPF) {
+                return {};
+            }
+            const auto exponent = settings.shape > 0.0 ? settings.shape : 1.0;
+            std::vector<double> weights;
+            for (uint64_t k = 1; k <= static_cast<uint64_t>(settings.max_volume - settings.min_volume) + 1; ++k) {
+                weights.push_back(1.0 / std::pow(static_cast<double>(k), exponent));
+            }
+            return std::discrete_distribution<>(weights.begin(), weights.end());
+        }
+    }
+
+    auto Workload::model_of(const std::string& name) -> Model {
+        if (name == "zipf")
+            return Model::ZIPF;
+        if (name == "pareto")
+            return Model::PARETO;
+        if (name == "bimodal")
+            return Model::BIMODAL;
+        if (name == "bursts")
+            return Model::BURSTS;
+        if (name == "trace")
+            return Model::TRACE;
+        return Model::UNIFORM;
+    }
+
+    auto Workload::service_of(const std::string& name) -> Service {
+        if (name == "exponential")
+            return Service::EXPONENTIAL;
+        return Service::CONSTANT;
+    }
+
+    Workload::Workload(const Settings& settings, uint64_t rank)
+      : __settings(settings),
+        __uniform(settings.min_volume, settings.max_volume),
+        __zipf(zipf_of(settings)),
+        __on(true),
+        __records({}),
+        __next(0),
+        __recorded(-1.0) {
+        if (settings.model != Model::TRACE) {
+            return;
+        }
+
+        // Winemaker stocking nothing would keep its safehouse empty and held forever, zero volumes are skipped.
+        uint64_t empty = 0;
+        if (auto file = std::fopen(settings.trace.c_str(), "r")) {
+            char line[256];
+            while (std::fgets(line, sizeof(line), file) != nullptr) {
+                unsigned long long actor;
+                unsigned long volume;
+                double service_time = -1.0;
+                if (line[0] == '#' || std::sscanf(line, "%llu %lu %lf", &actor, &volume, &service_time) < 2 || actor != rank) {
+                    continue;
+                }
+                if (volume == 0) {
+                    ++empty;
+                    continue;
+                }
+                __records.push_back({ static_cast<uint32_t>(volume), service_time });
+            }
+            std::fclose(file);
+        }
+        if (empty > 0) {
+            fmt::print(stderr, "Trace {} has {} records of actor #{} with zero volume, skipped.\n", settings.trace, empty, rank);
+        }
+        if (__records.empty()) {
+            fmt::print(stderr, "Trace {} has no records of actor #{}, its volumes are uniform.\n", settings.trace, rank);
+        }
+    }
+
+    auto Workload::volume(std::mt19937& rng) -> uint32_t {
+        const auto min = __settings.min_volume;
+        const auto max = __settings.max_volume;
+        switch (__settings.model) {
+            case Model::ZIPF:
+                return min + __zipf(rng);
+            case Model::PARETO: {
+                const auto index = __settings.shape > 0.0 ? __settings.shape : 1.16;
+                const auto uniform = std::uniform_real_distribution<>(0.0, 1.0)(rng);
+                const auto volume = std::max<double>(min, 1.0) / std::pow(1.0 - uniform, 1.0 / index);
+                return static_cast<uint32_t>(std::min<double>(volume, max));
+            }
+            case Model::BIMODAL: {
+                const auto small = __settings.shape > 0.0 ? __settings.shape : 0.9;
+                const auto tenth = (max - min) / 10;
+                if (std::bernoulli_distribution(small)(rng)) {
+                    return std::uniform_int_distribution<uint32_t>(min, min + tenth)(rng);
+                }
+                return std::uniform_int_distribution<uint32_t>(max - tenth, max)(rng);
+            }
+            case Model::BURSTS: {
+                const auto length = __settings.shape > 0.0 ? __settings.shape : 16.0;
+                if (std::bernoulli_distribution(1.0 / std::max(length, 1.0))(rng)) {
+                    __on = !__on;
+                }
+                return __on ? std::uniform_int_distribution<uint32_t>(min + (max - min) / 2, max)(rng) : min;
+            }
+            case Model::TRACE:
+                if (!__records.empty()) {
+                    const auto& record = __records[__next];
+                    __next = (__next + 1) % __records.size();
+                    __recorded = record.service_time;
+                    return record.volume;
+                }
+                return __uniform(rng);
+            case Model::UNIFORM:
+            default:
+                return __uniform(rng);
+        }
+    }
+
+    auto Workload::service_time(std::mt19937& rng) -> double {
+        if (__recorded >= 0.0) {
+            return __recorded;
+        }
+        if (__settings.service_time <= 0.0) {
+            return 0.0;
+        }
+        switch (__settings.service) {
+            case Service::EXPONENTIAL:
+                return std::exponential_distribution<>(1.0 / __settings.service_time)(rng);
+            case Service::CONSTANT:
+            default:
+                return __settings.service_time;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace nouveaux {
+
+    // Wine volumes actor supplies (winemaker) or demands (student) and time every acquisition keeps it busy.
+    //
+    // Draws come from the actor's own generator, so fixed seeds keep runs repeatable.
+    class Workload {
+      public:
+        enum class Model {
+            // Uniformly random volume in [min, max].
+            UNIFORM,
+            // Volume `min + k - 1` with probability proportional to 1 / k^shape (shape defaults to 1),
+            // small volumes are common, large ones rare. Keeps weight of every volume in the range.
+            ZIPF,
+            // `min / U^(1 / shape)` capped at `max` (shape defaults to 1.16, the 80/20 rule), heavy tail.
+            PARETO,
+            // Lowest tenth of the range with probability `shape` (defaults to 0.9), highest tenth otherwise.
+            BIMODAL,
+            // On/off source, phases last geometrically distributed number of draws with mean `shape`
+            // (defaults to 16). On phase draws uniformly from upper half of the range, off phase draws `min`.
+            BURSTS,
+            // Volumes (and service times, if recorded) of the actor replayed from trace file, cycling at its end.
+            // Records with zero volume are skipped.
+            TRACE,
+        };
+
+        // Distribution of service times around their mean.
+        enum class Service {
+            CONSTANT,
+            EXPONENTIAL,
+        };
+
+        struct Settings {
+            Model model;
+            uint32_t min_volume;
+            uint32_t max_volume;
+            // Parameter of the model, zero picks model's default.
+            double shape;
+            // Text file of `<rank> <volume> [<service seconds>]` lines, `#` starts a comment.
+            std::string trace;
+            Service service;
+            // Mean seconds single acquisition keeps actor busy, zero makes it instant.
+            double service_time;
+        };
+
+        // Unknown names fall back to UNIFORM and CONSTANT respectively.
+        [[nodiscard]] static auto model_of(const std::string& name) -> Model;
+        [[nodiscard]] static auto service_of(const std::string& name) -> Service;
+
+      private:
+        struct Record {
+            uint32_t volume;
+            // Negative when trace doesn't record it.
+            double service_time;
+        };
+
+        const Settings __settings;
+        std::uniform_int_distribution<> __uniform;
+        // Zipf only, weights of volumes `min` to `max`.
+        std::discrete_distribution<> __zipf;
+        // Bursts only, whether current phase is on.
+        bool __on;
+        // Trace only, actor's records and the next one to replay.
+        std::vector<Record> __records;
+        size_t __next;
+        // Service time of the latest replayed record.
+        double __recorded;
+
+      public:
+        // Reads trace of actor `rank` if the model replays one. Actor without any record falls back to UNIFORM.
+        Workload(const Settings& settings, uint64_t rank);
+
+        // Next volume supplied or demanded.
+        [[nodiscard]] auto volume(std::mt19937& rng) -> uint32_t;
+        // Seconds the acquisition of the latest volume keeps actor busy.
+        [[nodiscard]] auto service_time(std::mt19937& rng) -> double;
+    };
+}
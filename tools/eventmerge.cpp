@@ -0,0 +1,252 @@
+// Merges binary per-rank event logs (see `EventLog`) into one trace ordered by (Lamport clock, rank).
+//
+// Every input is memory mapped and already sorted by clock, so a k-way merge over a heap of
+// the inputs' next records streams the global order with memory independent of trace size.
+// Output is text (one line per record) or, with -b, a single binary log readable by this tool again.
+//
+// Usage: eventmerge [-b] [-o output] logs/events_*.bin
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <vector>
+
+#include "../src/codec.hpp"
+#include "../src/event_log.hpp"
+
+using namespace nouveaux;
+
+namespace {
+    using Record = EventLog::Record;
+
+    struct Input {
+        const char* path;
+        void* map;
+        size_t size;
+        const Record* records;
+        size_t count;
+        size_t next;
+    };
+
+    auto open_input(const char* path, Input& input) -> bool {
+        input = Input { path, nullptr, 0, nullptr, 0, 0 };
+
+        auto fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            std::perror(path);
+            return false;
+        }
+
+        struct stat status;
+        if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(EventLog::Header)) {
+            std::fprintf(stderr, "%s: not an event log\n", path);
+            close(fd);
+            return false;
+        }
+
+        input.size = status.st_size;
+        input.map = mmap(nullptr, input.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (input.map == MAP_FAILED) {
+            std::perror(path);
+            return false;
+        }
+        madvise(input.map, input.size, MADV_SEQUENTIAL);
+
+        const auto header = static_cast<const EventLog::Header*>(input.map);
+        if (std::memcmp(header->magic, EventLog::MAGIC, sizeof(EventLog::MAGIC)) != 0 || header->version != EventLog::VERSION || header->record_size != sizeof(Record)) {
+            std::fprintf(stderr, "%s: not an event log of this version\n", path);
+            munmap(input.map, input.size);
+            return false;
+        }
+
+        input.records = reinterpret_cast<const Record*>(static_cast<const char*>(input.map) + sizeof(EventLog::Header));
+        // Trailing partial record (eg. killed writer) is ignored.
+        input.count = (input.size - sizeof(EventLog::Header)) / sizeof(Record);
+        return true;
+    }
+
+    // Output buffered by hand, formatting every record with fprintf would dominate the merge.
+    class Writer {
+        FILE* __file;
+        std::vector<char> __buffer;
+        size_t __used;
+
+      public:
+        static constexpr size_t CAPACITY = 1 << 20;
+        // Longest text line of single record, buffer is flushed before it could overflow.
+        static constexpr size_t LINE_CAPACITY = 512;
+
+        explicit Writer(FILE* file)
+          : __file(file),
+            __buffer(CAPACITY),
+            __used(0) {}
+
+        ~Writer() { flush(); }
+
+        auto reserve(size_t size) -> void {
+            if (__used + size > __buffer.size()) {
+                flush();
+            }
+        }
+
+        auto put(const void* data, size_t size) -> void {
+            reserve(size);
+            std::memcpy(__buffer.data() + __used, data, size);
+            __used += size;
+        }
+
+        auto put(const char* text) -> void {
+            put(text, std::strlen(text));
+        }
+
+        // Decimal number left padded with zeros to `width` digits.
+        auto put(uint64_t value, int width = 0) -> void {
+            char digits[20];
+            int length = 0;
+            do {
+                digits[length++] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while (value != 0);
+            while (length < width) {
+                digits[length++] = '0';
+            }
+            reserve(length);
+            while (length > 0) {
+                __buffer[__used++] = digits[--length];
+            }
+        }
+
+        auto flush() -> void {
+            std::fwrite(__buffer.data(), 1, __used, __file);
+            __used = 0;
+        }
+    };
+
+    auto write_text(Writer& out, const Record& record) -> void {
+        out.reserve(Writer::LINE_CAPACITY);
+        out.put("[");
+        out.put(record.clock, 10);
+        out.put("] #");
+        out.put(record.rank);
+        if (record.kind == EventLog::SEND) {
+            out.put(" SEND ");
+        } else {
+            out.put(" RECV ");
+        }
+        out.put(codec::layout(static_cast<Message::Type>(record.type)).name);
+        if (record.kind == EventLog::SEND) {
+            out.put(" -> ");
+        } else {
+            out.put(" <- ");
+        }
+        if (record.peer == EventLog::FANOUT) {
+            out.put("*");
+            out.put(record.receivers);
+        } else {
+            out.put(record.peer);
+        }
+        out.put(" { timestamp: ");
+        out.put(record.timestamp);
+        out.put(", safehouse: ");
+        out.put(record.safehouse_index);
+        out.put(", volume: ");
+        out.put(record.wine_volume);
+        out.put(", last timestamp: ");
+        out.put(record.last_timestamp);
+        out.put(" }\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    bool binary = false;
+    const char* output = nullptr;
+    int option;
+    while ((option = getopt(argc, argv, "bo:")) != -1) {
+        switch (option) {
+            case 'b':
+                binary = true;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                std::fprintf(stderr, "Usage: %s [-b] [-o output] logs/events_*.bin\n", argv[0]);
+                return -1;
+        }
+    }
+
+    std::vector<Input> inputs;
+    for (int i = optind; i < argc; ++i) {
+        Input input;
+        if (open_input(argv[i], input)) {
+            inputs.push_back(input);
+        }
+    }
+
+    auto file = output != nullptr ? std::fopen(output, "wb") : stdout;
+    if (file == nullptr) {
+        std::perror(output);
+        return -1;
+    }
+
+    {
+        Writer out(file);
+        if (binary) {
+            EventLog::Header header {};
+            std::memcpy(header.magic, EventLog::MAGIC, sizeof(EventLog::MAGIC));
+            header.version = EventLog::VERSION;
+            header.record_size = sizeof(Record);
+            out.put(&header, sizeof(header));
+        }
+
+        // Heap of inputs ordered by their next record, ties on (clock, rank) keep input order.
+        auto later = [&](size_t lhs, size_t rhs) {
+            const auto& left = inputs[lhs].records[inputs[lhs].next];
+            const auto& right = inputs[rhs].records[inputs[rhs].next];
+            if (left.clock != right.clock)
+                return left.clock > right.clock;
+            if (left.rank != right.rank)
+                return left.rank > right.rank;
+            return lhs > rhs;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (inputs[i].count > 0) {
+                heap.push(i);
+            }
+        }
+
+        while (!heap.empty()) {
+            auto index = heap.top();
+            heap.pop();
+
+            auto& input = inputs[index];
+            const auto& record = input.records[input.next];
+            if (binary) {
+                out.put(&record, sizeof(record));
+            } else {
+                write_text(out, record);
+            }
+
+            if (++input.next < input.count) {
+                heap.push(index);
+            }
+        }
+    }
+
+    for (auto&& input : inputs) {
+        munmap(input.map, input.size);
+    }
+    if (file != stdout) {
+        std::fclose(file);
+    }
+
+    return 0;
+}